@@ -0,0 +1,714 @@
+#include "Aot.h"
+#include "BlockCache.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+//the most cycles one chunk of open coded instructions checks for, same trade off as the jit's (see Jit.cpp)
+static const int AOT_CHUNK_CYCLES = 16;
+
+namespace
+{
+	//what the generated code does with an instruction
+	enum Kind
+	{
+		INLINE, //open coded, a store or push that isn't to plain ram leaves the block
+		STORE, //a static store somewhere writeMemory has to look at, through AotRuntime::store
+		GENERIC //the interpreter's handler, through AotRuntime::execute
+	};
+
+	const char * const registerNames[8] = { "cpu.b", "cpu.c", "cpu.d", "cpu.e", "cpu.h", "cpu.l", "(hl)", "cpu.a" };
+	const char * const pairGetters[4] = { "cpu.bc()", "cpu.de()", "cpu.hl()", "cpu.sp" };
+	const char * const pairSetters[4] = { "cpu.setBC", "cpu.setDE", "cpu.setHL", NULL };
+	const char * const conditionNames[4] = { "NZ", "Z", "NC", "C" };
+
+	bool ramAddress(Address address)
+	{
+		return (address >= 0xC000 && address <= 0xDFFF) || (address >= 0xFF80 && address <= 0xFFFE);
+	}
+
+	//what the jit does inline plus the stack, except DI, EI & RETI which need the emulator
+	Kind kind(const MicroOp & op)
+	{
+		const int code = op.code, x = code >> 6, y = (code >> 3) & 7, z = code & 7, q = y & 1;
+
+		if (x == 1 || x == 2)
+			return INLINE;
+
+		if (x == 0)
+		{
+			if (z == 0 && (y == 1 || y == 2)) //LD (nn),SP & STOP
+				return GENERIC;
+			if ((z == 4 || z == 5) && y == 6) //INC/DEC (HL)
+				return GENERIC;
+			if (code == 0x27) //DAA
+				return GENERIC;
+			return INLINE;
+		}
+
+		switch (z)
+		{
+		case 0:
+			if (y == 4)
+				return (op.value >= 0x80 && op.value != 0xFF) ? INLINE : STORE;
+			return (y < 4 || y == 6) ? INLINE : GENERIC; //RET cc & LDH A,(n)
+		case 1:
+			if (q == 0) //POP
+				return INLINE;
+			return (y == 1 || y == 7) ? INLINE : GENERIC; //RET & LD SP,HL
+		case 2:
+			if (y == 4)
+				return STORE;
+			if (y == 5)
+				return ramAddress((Address)(op.value2 << 8 | op.value)) ? INLINE : STORE;
+			return INLINE;
+		case 3:
+			if (y == 1)
+				return ((op.value & 7) != 6 || (op.value >> 6) == 1) ? INLINE : GENERIC; //CB, (HL) ones only for BIT
+			return (y == 0) ? INLINE : GENERIC; //JP
+		case 4:
+			return (y < 4) ? INLINE : GENERIC; //CALL cc
+		case 5:
+			return (q == 0 || y == 1) ? INLINE : GENERIC; //PUSH & CALL
+		case 6: case 7: //alu A,n & RST
+			return INLINE;
+		default:
+			return GENERIC;
+		}
+	}
+
+	/*Writes one block out as a function working on an AotCpu. The cycles since the hardware last caught up (ran) & the
+	last instruction run are kept at run time, the compiler folds them between jumps & calls out.*/
+	class BlockWriter
+	{
+	public:
+		BlockWriter(FILE * out) : out(out) {}
+
+		void block(uint32_t key, const std::vector<MicroOp> & ops);
+
+	private:
+		FILE * out;
+		std::string body; //the function's statements, the locals it needs go in front of them
+		bool usesAddress, usesValue, usesLeave;
+
+		std::vector<Address> pcs;
+		std::vector<int> chunks; //worst case cycles of the chunk starting at each instruction, 0 if one doesn't
+		std::vector<bool> targets; //instructions the block jumps back (or forward) to, they get a label
+
+		Address pc; //of the instruction being written
+		int cycles; //it takes when it doesn't jump
+		int length;
+
+		void emit(const char * format, ...);
+		int indexOf(Address address) const;
+		std::string readR8(int r);
+		void writeR8(int r, const std::string & value);
+		void write(const std::string & address, const std::string & value);
+		void store(const std::string & address);
+		void leave(const char * indent, const std::string & next);
+		void jump(int condition, Address target, int taken);
+		void push(const std::string & value);
+		void call(int condition, Address target);
+		void ret(int condition);
+		void inlineOp(const MicroOp & op);
+		void generic(const MicroOp & op);
+		void ran(int taken);
+	};
+
+	void BlockWriter::emit(const char * format, ...)
+	{
+		char line[256];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(line, sizeof(line), format, args);
+		va_end(args);
+		body += line;
+	}
+
+	//the index of the instruction at address, -1 when it isn't one of the block's
+	int BlockWriter::indexOf(Address address) const
+	{
+		for (size_t i = 0; i < pcs.size(); i++)
+		{
+			if (pcs[i] == address)
+				return (int)i;
+		}
+		return -1;
+	}
+
+	//an expression for register r, (HL) gets read first
+	std::string BlockWriter::readR8(int r)
+	{
+		if (r != 6)
+			return registerNames[r];
+
+		usesValue = true;
+		emit("\tvalue = aotRead(emu, runtime, frame, cpu.hl());\n");
+		return "value";
+	}
+
+	void BlockWriter::writeR8(int r, const std::string & value)
+	{
+		if (r == 6)
+			write("cpu.hl()", value);
+		else if (value != registerNames[r])
+			emit("\t%s = %s;\n", registerNames[r], value.c_str());
+	}
+
+	/*Stores straight into work & high ram no cached block covers, anything else is written by writeMemory & leaves the
+	block whatever it did (it's rare & whatever it did has to be looked at)*/
+	void BlockWriter::write(const std::string & address, const std::string & value)
+	{
+		usesAddress = usesValue = true;
+		if (address != "address")
+			emit("\taddress = %s;\n", address.c_str());
+		if (value != "value")
+			emit("\tvalue = %s;\n", value.c_str());
+		emit("\tif (aotPlainRam(frame, address))\n\t\tframe.memory[address] = value;\n");
+		emit("\telse\n\t{\n\t\tcpu.spill(frame.registers);\n");
+		emit("\t\truntime.store(emu, address | value << 16 | %d << 24, 0x%04X, ran | %d << 16);\n", length, pc, cycles);
+		emit("\t\treturn;\n\t}\n");
+	}
+
+	//A to somewhere that isn't plain ram, the block carries on if nothing came of it
+	void BlockWriter::store(const std::string & address)
+	{
+		emit("\tcpu.spill(frame.registers);\n");
+		emit("\tif ((quiet = runtime.store(emu, (%s) | cpu.a << 16 | %d << 24, 0x%04X, ran | %d << 16)) < 0)\n",
+			address.c_str(), length, pc, cycles);
+		emit("\t\treturn;\n\tran = 0;\n\tlast = -1;\n");
+	}
+
+	void BlockWriter::leave(const char * indent, const std::string & next)
+	{
+		usesLeave = true;
+		emit("%snext = %s;\n%sgoto leave;\n", indent, next.c_str(), indent);
+	}
+
+	void BlockWriter::ran(int taken)
+	{
+		emit("\tran += %d;\n\tlast = 0x%08X;\n", taken, pc | taken << 16);
+	}
+
+	//condition is the cc field or < 0, a jump to one of the block's own instructions goes straight there
+	void BlockWriter::jump(int condition, Address target, int taken)
+	{
+		const char * indent = (condition < 0) ? "\t" : "\t\t";
+		if (condition >= 0)
+			emit("\tif (cpu.condition(%d)) //%s\n\t{\n", condition, conditionNames[condition]);
+
+		emit("%sran += %d;\n%slast = 0x%08X;\n", indent, taken, indent, pc | taken << 16);
+		int into = indexOf(target);
+		char text[16];
+		snprintf(text, sizeof(text), "0x%04X", target);
+		if (into >= 0)
+			emit("%sgoto op_%d;\n", indent, into);
+		else
+			leave(indent, text);
+
+		if (condition >= 0)
+		{
+			emit("\t}\n");
+			ran(cycles);
+		}
+	}
+
+	//the stack has to be plain ram, otherwise the emulator runs the instruction after leaving
+	void BlockWriter::push(const std::string & value)
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "0x%04X", pc);
+		emit("\tif (!aotPlainRam(frame, (uint16_t)(cpu.sp - 1)) || !aotPlainRam(frame, (uint16_t)(cpu.sp - 2)))\n\t{\n");
+		leave("\t\t", text);
+		emit("\t}\n");
+		usesValue = true;
+		emit("\tvalue = (uint8_t)((%s) >> 8);\n", value.c_str());
+		emit("\tframe.memory[--cpu.sp] = value;\n\tframe.memory[--cpu.sp] = (uint8_t)(%s);\n", value.c_str());
+	}
+
+	void BlockWriter::call(int condition, Address target)
+	{
+		char text[16];
+		int taken = emulator_opcode_cycles((Byte)((condition < 0) ? 0xCD : 0xC4 | condition << 3), 0, true);
+		if (condition >= 0)
+			emit("\tif (cpu.condition(%d)) //%s\n\t{\n", condition, conditionNames[condition]);
+
+		//the return address was worked out when the block was generated
+		snprintf(text, sizeof(text), "0x%04X", (Address)(pc + length));
+		push(text);
+		emit("\tran += %d;\n\tlast = 0x%08X;\n", taken, pc | taken << 16);
+		snprintf(text, sizeof(text), "0x%04X", target);
+		leave("\t", text);
+
+		if (condition >= 0)
+		{
+			emit("\t}\n");
+			ran(cycles);
+		}
+	}
+
+	void BlockWriter::ret(int condition)
+	{
+		int taken = emulator_opcode_cycles((Byte)((condition < 0) ? 0xC9 : 0xC0 | condition << 3), 0, true);
+		if (condition >= 0)
+			emit("\tif (cpu.condition(%d)) //%s\n\t{\n", condition, conditionNames[condition]);
+
+		usesAddress = true;
+		emit("\taddress = aotRead(emu, runtime, frame, cpu.sp);\n");
+		emit("\taddress |= aotRead(emu, runtime, frame, (uint16_t)(cpu.sp + 1)) << 8;\n\tcpu.sp += 2;\n");
+		emit("\tran += %d;\n\tlast = 0x%08X;\n", taken, pc | taken << 16);
+		leave("\t", "address");
+
+		if (condition >= 0)
+		{
+			emit("\t}\n");
+			ran(cycles);
+		}
+	}
+
+	void BlockWriter::inlineOp(const MicroOp & op)
+	{
+		const int code = op.code, x = code >> 6, y = (code >> 3) & 7, z = code & 7, p = y >> 1, q = y & 1;
+		const Address next = (Address)(pc + op.length);
+		const Address immediate = (Address)(op.value2 << 8 | op.value);
+		char text[64];
+
+		if (x == 1) //LD r,r & HALT
+		{
+			if (code == 0x76)
+			{
+				emit("\tcpu.spill(frame.registers);\n\truntime.halt(emu, ran + %d, 0x%04X, quiet);\n\treturn;\n", cycles, pc);
+				return;
+			}
+			writeR8(y, readR8(z));
+			ran(cycles);
+			return;
+		}
+
+		if (x == 2) //alu A,r
+		{
+			std::string value = readR8(z);
+			emit("\tcpu.alu(%d, %s);\n", y, value.c_str());
+			ran(cycles);
+			return;
+		}
+
+		if (x == 0)
+		{
+			switch (z)
+			{
+			case 0: //NOP & JR
+				if (y >= 3)
+				{
+					jump((y == 3) ? -1 : y - 4, (Address)(next + (Byte_Signed)op.value), emulator_opcode_cycles(op.code, 0, true));
+					return;
+				}
+				break;
+
+			case 1:
+				if (q == 0 && p == 3)
+					emit("\tcpu.sp = 0x%04X;\n", immediate);
+				else if (q == 0)
+					emit("\t%s(0x%04X);\n", pairSetters[p], immediate);
+				else
+					emit("\tcpu.addHL(%s);\n", pairGetters[p]);
+				break;
+
+			case 2: //(BC) (DE) (HL+) (HL-)
+				usesAddress = true;
+				emit("\taddress = %s;\n", pairGetters[(p < 2) ? p : 2]);
+				if (p >= 2)
+					emit("\tcpu.setHL(address %s 1);\n", (p == 2) ? "+" : "-");
+				if (q == 0)
+					write("address", "cpu.a");
+				else
+					emit("\tcpu.a = aotRead(emu, runtime, frame, address);\n");
+				break;
+
+			case 3: //INC/DEC rr
+				if (p == 3)
+					emit("\tcpu.sp%s;\n", (q == 0) ? "++" : "--");
+				else
+					emit("\t%s(%s %s 1);\n", pairSetters[p], pairGetters[p], (q == 0) ? "+" : "-");
+				break;
+
+			case 4: case 5:
+				emit("\t%s = cpu.%s(%s);\n", registerNames[y], (z == 4) ? "inc" : "dec", registerNames[y]);
+				break;
+
+			case 6:
+				snprintf(text, sizeof(text), "0x%02X", op.value);
+				writeR8(y, text);
+				break;
+
+			case 7:
+				if (y < 4) //RLCA RRCA RLA RRA
+					emit("\tcpu.a = cpu.shift(%d, cpu.a, false);\n", y);
+				else
+					emit("\tcpu.%s();\n", (y == 5) ? "cpl" : (y == 6) ? "scf" : "ccf");
+				break;
+			}
+			ran(cycles);
+			return;
+		}
+
+		switch (z)
+		{
+		case 0:
+			if (y < 4)
+			{
+				ret(y);
+				return;
+			}
+			if (y == 4) //LDH (n),A into high ram
+			{
+				snprintf(text, sizeof(text), "0x%04X", 0xFF00 + op.value);
+				write(text, "cpu.a");
+			}
+			else //LDH A,(n)
+				emit("\tcpu.a = aotRead(emu, runtime, frame, 0x%04X);\n", 0xFF00 + op.value);
+			break;
+
+		case 1:
+			if (q == 0) //POP, the lower nibble of F always reads 0
+			{
+				emit("\t%s(aotRead(emu, runtime, frame, (uint16_t)(cpu.sp + 1)) << 8 | aotRead(emu, runtime, frame, cpu.sp));\n",
+					(p == 3) ? "cpu.setAF" : pairSetters[p]);
+				emit("\tcpu.sp += 2;\n");
+			}
+			else if (y == 1)
+			{
+				ret(-1);
+				return;
+			}
+			else //LD SP,HL
+				emit("\tcpu.sp = cpu.hl();\n");
+			break;
+
+		case 2:
+			if (y < 4)
+			{
+				jump(y, immediate, emulator_opcode_cycles(op.code, 0, true));
+				return;
+			}
+			if (y == 5) //LD (nn),A into ram
+			{
+				snprintf(text, sizeof(text), "0x%04X", immediate);
+				write(text, "cpu.a");
+			}
+			else if (y == 6) //LD A,(C)
+				emit("\tcpu.a = aotRead(emu, runtime, frame, 0xFF00 | cpu.c);\n");
+			else
+				emit("\tcpu.a = aotRead(emu, runtime, frame, 0x%04X);\n", immediate);
+			break;
+
+		case 3:
+			if (y == 0)
+			{
+				jump(-1, immediate, cycles);
+				return;
+			}
+			else //CB
+			{
+				const int cx = op.value >> 6, cy = (op.value >> 3) & 7, cz = op.value & 7;
+				if (cx == 0)
+					emit("\t%s = cpu.shift(%d, %s, true);\n", registerNames[cz], cy, registerNames[cz]);
+				else if (cx == 1)
+				{
+					std::string value = readR8(cz);
+					emit("\tcpu.bit(%d, %s);\n", cy, value.c_str());
+				}
+				else
+					emit("\t%s %s= 0x%02X;\n", registerNames[cz], (cx == 2) ? "&" : "|", (cx == 2) ? (~(1 << cy) & 0xFF) : 1 << cy);
+			}
+			break;
+
+		case 4: case 5: //CALL cc, PUSH & CALL
+			if (z == 5 && q == 0)
+				push((p == 3) ? "cpu.a << 8 | cpu.f" : pairGetters[p]);
+			else
+			{
+				call((z == 4) ? y : -1, immediate);
+				return;
+			}
+			break;
+
+		case 6:
+			emit("\tcpu.alu(%d, 0x%02X);\n", y, op.value);
+			break;
+
+		case 7: //RST
+			snprintf(text, sizeof(text), "0x%04X", next);
+			push(text);
+			ran(cycles);
+			snprintf(text, sizeof(text), "0x%04X", y * 8);
+			leave("\t", text);
+			return;
+		}
+		ran(cycles);
+	}
+
+	//the interpreter's handler with the hardware caught up after it, the registers go through the emulator
+	void BlockWriter::generic(const MicroOp & op)
+	{
+		emit("\tcpu.spill(frame.registers);\n");
+		emit("\tif ((quiet = runtime.execute(emu, 0x%08X, 0x%04X, ran)) < 0)\n\t\treturn;\n",
+			op.code | op.value << 8 | op.value2 << 16 | op.length << 24, pc);
+		emit("\tcpu.load(frame.registers);\n\tran = 0;\n\tlast = -1;\n");
+	}
+
+	void BlockWriter::block(uint32_t key, const std::vector<MicroOp> & ops)
+	{
+		const size_t count = ops.size();
+		const Address start = (Address)key;
+
+		pcs.resize(count);
+		for (size_t i = 0; i < count; i++)
+			pcs[i] = (i == 0) ? start : (Address)(pcs[i - 1] + ops[i - 1].length);
+
+		//whatever the block jumps to inside itself starts a chunk so it can go straight there
+		targets.assign(count, false);
+		for (size_t i = 0; i < count; i++)
+		{
+			const MicroOp & op = ops[i];
+			int into = -1;
+			if (op.code == 0x18 || (op.code & 0xE7) == 0x20) //JR & JR cc
+				into = indexOf((Address)(pcs[i] + op.length + (Byte_Signed)op.value));
+			else if (op.code == 0xC3 || (op.code & 0xE7) == 0xC2) //JP & JP cc
+				into = indexOf((Address)(op.value2 << 8 | op.value));
+			if (into >= 0)
+				targets[into] = true;
+		}
+
+		//the chunks: each run of inline instructions, split so none checks for more than AOT_CHUNK_CYCLES
+		std::vector<Kind> kinds(count);
+		chunks.assign(count, 0);
+		int open = -1;
+		for (size_t i = 0; i < count; i++)
+		{
+			kinds[i] = kind(ops[i]);
+			if (kinds[i] != INLINE)
+			{
+				open = -1;
+				continue;
+			}
+
+			int worst = emulator_opcode_cycles(ops[i].code, ops[i].value, true);
+			if (open < 0 || targets[i] || chunks[open] + worst > AOT_CHUNK_CYCLES)
+				open = (int)i;
+			chunks[open] += worst;
+		}
+
+		body.clear();
+		usesAddress = usesValue = usesLeave = false;
+		bool left = false;
+		for (size_t i = 0; i < count; i++)
+		{
+			const MicroOp & op = ops[i];
+			pc = pcs[i];
+			length = op.length;
+			cycles = emulator_opcode_cycles(op.code, op.value, false);
+
+			char disassembly[64];
+			emulator_disassemble(pc, op.code, op.value, op.value2, disassembly, sizeof(disassembly));
+			for (size_t end = strlen(disassembly); end > 0 && disassembly[end - 1] == ' '; end--)
+				disassembly[end - 1] = '\0';
+
+			emit("\n");
+			if (targets[i])
+				emit("op_%d:\n", (int)i);
+			emit("\t//%s\n", disassembly);
+			if (chunks[i] > 0)
+			{
+				char text[16];
+				snprintf(text, sizeof(text), "0x%04X", pc);
+				emit("\tif ((quiet -= %d) < 0)\n\t{\n", chunks[i]);
+				leave("\t\t", text);
+				emit("\t}\n");
+			}
+
+			if (kinds[i] == INLINE)
+				inlineOp(op);
+			else if (kinds[i] == GENERIC)
+				generic(op);
+			else if (op.code == 0xE2) //LD (C),A
+				store("0xFF00 | cpu.c");
+			else
+			{
+				char address[16];
+				snprintf(address, sizeof(address), "0x%04X", (op.code == 0xE0) ? 0xFF00 + op.value : op.value2 << 8 | op.value);
+				store(address);
+			}
+
+			//JR, JP, HALT & the stack's jumps end the block, everything else that does has already left
+			left = op.code == 0x18 || op.code == 0xC3 || op.code == 0x76 || op.code == 0xCD || op.code == 0xC9 ||
+				(kinds[i] == INLINE && (op.code & 0xC7) == 0xC7);
+		}
+
+		if (!left)
+		{
+			char text[16];
+			snprintf(text, sizeof(text), "0x%04X", (count > 0) ? (Address)(pc + length) : start);
+			leave("\t", text);
+		}
+
+		fprintf(out, "static void block_%02X_%04X(Emulator * emu, int quiet, int)\n{\n", key >> 16, start);
+		fprintf(out, "\tAotFrame frame;\n\truntime.frame(emu, &frame);\n\tAotCpu cpu;\n\tcpu.load(frame.registers);\n");
+		fprintf(out, "\tint ran = 0, last = -1%s%s;\n", usesLeave ? ", next" : "", usesAddress ? ", address" : "");
+		if (usesValue)
+			fprintf(out, "\tuint8_t value;\n");
+		fputs(body.c_str(), out);
+		if (usesLeave)
+			fprintf(out, "\nleave:\n\tcpu.spill(frame.registers);\n\truntime.leave(emu, ran, next, last);\n");
+		fprintf(out, "}\n\n");
+	}
+}
+
+bool Emulator::writeAotModule(const char * romLocation, const char * outPath)
+{
+	if (blockCache == NULL)
+		setCpuEngine(CPU_BLOCK_CACHE);
+
+	//blocks a previous run found (including the ones only reachable through ram code or a bank switch) become extra seeds
+	std::string cachePath = std::string(romLocation) + ".tcache";
+	int recorded = blockCache->load(cachePath.c_str(), romChecksum(), *this, NULL);
+
+	std::vector<uint32_t> seeds;
+	seeds.push_back(0x100);
+	for (uint32_t vector = 0x00; vector <= 0x60; vector += 0x08) //restarts 0x00-0x38, interrupts 0x40-0x60
+		seeds.push_back(vector);
+
+	std::vector<uint32_t> keys = blockCache->walk(*this, seeds);
+
+	FILE * out;
+	if (fopen_s(&out, outPath, "w") != 0 || out == NULL)
+		return false;
+
+	fprintf(out, "//generated by GrahamBoy -aot from %s, see Aot.h\n", romLocation);
+	fprintf(out, "#include \"Aot.h\"\n\n");
+	fprintf(out, "#ifdef _WIN32\n#define AOT_EXPORT extern \"C\" __declspec(dllexport)\n");
+	fprintf(out, "#else\n#define AOT_EXPORT extern \"C\" __attribute__((visibility(\"default\")))\n#endif\n\n");
+	fprintf(out, "static AotRuntime runtime;\n\n");
+
+	BlockWriter writer(out);
+	for (uint32_t key : keys)
+		writer.block(key, *blockCache->blockOps(key));
+
+	fprintf(out, "static const AotBlock blocks[] =\n{\n");
+	for (uint32_t key : keys)
+		fprintf(out, "\t{ 0x%08X, block_%02X_%04X },\n", key, key >> 16, key & 0xFFFF);
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static void bind(const AotRuntime * emulator)\n{\n\truntime = *emulator;\n}\n\n");
+	fprintf(out, "AOT_EXPORT const AotModule gb_aot_module = { AOT_MODULE_VERSION, 0x%016llXULL, %u, blocks, bind };\n",
+		(unsigned long long)romChecksum(), (unsigned)keys.size());
+
+	bool written = ferror(out) == 0;
+	fclose(out);
+
+	printf("%s: %u blocks (%d seeded from %s)\n", outPath, (unsigned)keys.size(), recorded, cachePath.c_str());
+	return written;
+}
+
+void Emulator::setAotModule(const char * path)
+{
+	aotModulePath = path ? path : "";
+}
+
+void Emulator::loadAotModule()
+{
+	if (aotModulePath.empty())
+		return;
+
+	if (jit == NULL)
+		setCpuEngine(CPU_JIT); //the module's blocks get run the same way compiled blocks are
+
+#ifdef _WIN32
+	HMODULE library = LoadLibraryA(aotModulePath.c_str());
+	const AotModule * module = library ? (const AotModule *)GetProcAddress(library, "gb_aot_module") : NULL;
+#else
+	//dlopen only searches the library path for names without a slash
+	std::string location = (aotModulePath.find('/') == std::string::npos) ? "./" + aotModulePath : aotModulePath;
+	void * library = dlopen(location.c_str(), RTLD_NOW | RTLD_LOCAL);
+	const AotModule * module = library ? (const AotModule *)dlsym(library, "gb_aot_module") : NULL;
+#endif
+	aotLibrary = (void *)library;
+
+	if (module == NULL)
+	{
+		printf("aot module: couldn't load %s\n", aotModulePath.c_str());
+		return;
+	}
+
+	if (module->version != AOT_MODULE_VERSION || module->romChecksum != romChecksum())
+	{
+		printf("aot module: %s was built for a different rom or emulator version\n", aotModulePath.c_str());
+		return;
+	}
+
+	static const AotRuntime runtime = { &Emulator::aotFrame, &Emulator::nativeRead, &Emulator::nativeStore, 
+		&Emulator::nativeExecute, &Emulator::aotLeave, &Emulator::aotHalt };
+	module->bind(&runtime);
+
+	uint32_t installed = 0;
+	for (uint32_t i = 0; i < module->blockCount; i++)
+	{
+		if (blockCache->install(*this, module->blocks[i].key, module->blocks[i].code))
+			installed++;
+	}
+
+	printf("aot module: %u blocks from %s\n", installed, aotModulePath.c_str());
+}
+
+static_assert(offsetof(HotState, reg_SP) == 4 * sizeof(Word) && offsetof(HotState, reg_PC) == 5 * sizeof(Word), 
+	"AotFrame::registers is BC DE HL AF SP PC");
+
+void Emulator::aotFrame(Emulator * emu, AotFrame * frame)
+{
+	frame->registers = &emu->reg_BC.reg; //BC DE HL AF SP PC are next to each other at the start of the hot state
+	frame->memory = emu->memory;
+	frame->readPages = emu->readPages;
+	frame->ramCode = emu->blockCache->ramCodeMap();
+}
+
+//what a compiled jit block does when it leaves (see Jit.cpp), nativeLast only changes when something ran
+void Emulator::aotLeave(Emulator * emu, int cycles, int pc, int last)
+{
+	emu->nativeFlush(cycles);
+	emu->reg_PC = (Address)pc;
+	if (cycles > 0)
+		emu->nativeLast = last;
+}
+
+/*The interpreter runs HALT again every 4 cycles until an interrupt wakes the cpu up, which can't happen while the
+hardware is quiet, so it sleeps through all of those in one go. If IE & IF are already set handleInterrupts wakes it
+straight away (there's nothing it could service, see nativeQuiet) & it's a NOP.*/
+void Emulator::aotHalt(Emulator * emu, int cycles, int pc, int quiet)
+{
+	if (emu->interruptPending)
+	{
+		aotLeave(emu, cycles, pc + 1, pc | cycles << 16);
+		return;
+	}
+
+	emu->halted = true;
+	aotLeave(emu, (quiet & ~3) + cycles, pc, pc | cycles << 16);
+}
+
+void Emulator::unloadAotModule()
+{
+	if (aotLibrary == NULL)
+		return;
+
+#ifdef _WIN32
+	FreeLibrary((HMODULE)aotLibrary);
+#else
+	dlclose(aotLibrary);
+#endif
+	aotLibrary = NULL;
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include <stdint.h>
+
+/*Ahead of time compilation of a rom. GrahamBoy -aot <rom> <out.cpp> finds all the code it can reach from the
+entry points (0x100, the restart & interrupt vectors & every block a <rom>.tcache file recorded) & writes each
+block out as a C++ function. Build that into a shared library (g++ -O2 -shared -fPIC -I GrahamBoy out.cpp -o game.so,
+or a DLL project in visual studio) & run the game with -aotmodule game.so. Anything the module doesn't have (ram code,
+jumps through HL, jumps into a bank it couldn't work out) runs on the jit/block cache like normal.
+
+The generated code works the same way a compiled jit block does (see Jit.h): the registers are copied into an
+AotCpu on the stack when a block is entered & only written back when it calls out or leaves, loads, stores to
+plain work & high ram, the alu, rotates, bit operations & jumps are all open coded. The block is split into chunks
+that each take their worst case cycles off the quiet cycles it was handed & leave if that runs out, the cycles
+that ran are handed to the timers & graphics once when it leaves (or calls out). Stores to io, anything touching the
+stack & the rarer instructions go through the emulator (AotRuntime).
+
+Only this header is shared with the generated code so it mustn't include anything from the emulator.*/
+
+class Emulator;
+
+//what the generated code needs of the emulator that's running it, filled in by AotRuntime::frame when a block is entered
+struct AotFrame
+{
+	uint16_t * registers; //BC DE HL AF SP PC, only up to date while the code is calling out
+	uint8_t * memory; //the whole address space, work & high ram get read & written straight through it
+	const uint8_t * const * readPages; //the 4KB pages below 0xF000, following the rom & ram banks (see Emulator::readPages)
+	const bool * ramCode; //0xC000-0xFFFF, set where a cached block's code is, those stores go through the emulator
+};
+
+/*The emulator's side (see Emulator::nativeStore & nativeExecute), handed to the module once before any of its blocks
+run. store & execute return how many cycles the hardware stays quiet for now, < 0 when the block has to be left.*/
+struct AotRuntime
+{
+	void (*frame)(Emulator * emu, AotFrame * frame);
+	uint8_t (*read)(Emulator * emu, int address); //anything that isn't in readPages, high ram or the io registers
+	int (*store)(Emulator * emu, int write, int pc, int cycles);
+	int (*execute)(Emulator * emu, int op, int pc, int pending);
+
+	//hands over the cycles that ran & leaves the PC at pc, last is the last instruction that ran (see runNative)
+	void (*leave)(Emulator * emu, int cycles, int pc, int last);
+
+	//HALT at pc, it sleeps through the rest of the quiet cycles unless it wakes up straight away
+	void (*halt)(Emulator * emu, int cycles, int pc, int quiet);
+};
+
+//the gameboy registers as locals of the generated code, F is always worked out
+struct AotCpu
+{
+	uint8_t b, c, d, e, h, l, a, f;
+	uint16_t sp;
+
+	void load(const uint16_t * registers)
+	{
+		b = (uint8_t)(registers[0] >> 8); c = (uint8_t)registers[0];
+		d = (uint8_t)(registers[1] >> 8); e = (uint8_t)registers[1];
+		h = (uint8_t)(registers[2] >> 8); l = (uint8_t)registers[2];
+		a = (uint8_t)(registers[3] >> 8); f = (uint8_t)registers[3];
+		sp = registers[4];
+	}
+
+	void spill(uint16_t * registers) const
+	{
+		registers[0] = bc();
+		registers[1] = de();
+		registers[2] = hl();
+		registers[3] = (uint16_t)(a << 8 | f);
+		registers[4] = sp;
+	}
+
+	uint16_t bc() const { return (uint16_t)(b << 8 | c); }
+	uint16_t de() const { return (uint16_t)(d << 8 | e); }
+	uint16_t hl() const { return (uint16_t)(h << 8 | l); }
+	void setBC(int value) { b = (uint8_t)(value >> 8); c = (uint8_t)value; }
+	void setDE(int value) { d = (uint8_t)(value >> 8); e = (uint8_t)value; }
+	void setHL(int value) { h = (uint8_t)(value >> 8); l = (uint8_t)value; }
+	void setAF(int value) { a = (uint8_t)(value >> 8); f = (uint8_t)(value & 0xF0); }
+
+	//the conditions of JR JP CALL & RET: NZ Z NC C
+	bool condition(int cc) const
+	{
+		return ((cc < 2) ? (f & 0x80) != 0 : (f & 0x10) != 0) == ((cc & 1) != 0);
+	}
+
+	//the 8 alu operations on A in opcode order, the lower nibble of F is kept like the interpreter does
+	void alu(int operation, uint8_t value)
+	{
+		int carry = (operation == 1 || operation == 3) ? (f >> 4) & 1 : 0;
+		int result, half;
+		switch (operation)
+		{
+		case 0: case 1:
+			result = a + value + carry;
+			half = (a & 0xF) + (value & 0xF) + carry;
+			f = (uint8_t)((f & 0x0F) | (((uint8_t)result == 0) ? 0x80 : 0) | ((half > 0xF) ? 0x20 : 0) | ((result > 0xFF) ? 0x10 : 0));
+			a = (uint8_t)result;
+			return;
+		case 2: case 3: case 7:
+			result = a - value - carry;
+			half = (a & 0xF) - (value & 0xF) - carry;
+			f = (uint8_t)((f & 0x0F) | 0x40 | (((uint8_t)result == 0) ? 0x80 : 0) | ((half < 0) ? 0x20 : 0) | ((result < 0) ? 0x10 : 0));
+			if (operation != 7)
+				a = (uint8_t)result;
+			return;
+		case 4:
+			a &= value;
+			f = (uint8_t)((f & 0x0F) | 0x20 | ((a == 0) ? 0x80 : 0));
+			return;
+		default:
+			a = (operation == 5) ? (uint8_t)(a ^ value) : (uint8_t)(a | value);
+			f = (uint8_t)((f & 0x0F) | ((a == 0) ? 0x80 : 0));
+			return;
+		}
+	}
+
+	//INC & DEC r, the carry is kept
+	uint8_t inc(uint8_t value)
+	{
+		value++;
+		f = (uint8_t)((f & 0x1F) | ((value == 0) ? 0x80 : 0) | (((value & 0xF) == 0) ? 0x20 : 0));
+		return value;
+	}
+
+	uint8_t dec(uint8_t value)
+	{
+		value--;
+		f = (uint8_t)((f & 0x1F) | 0x40 | ((value == 0) ? 0x80 : 0) | (((value & 0xF) == 0xF) ? 0x20 : 0));
+		return value;
+	}
+
+	//ADD HL,rr: Z is kept, H is the carry out of bit 11 & C out of bit 15
+	void addHL(int value)
+	{
+		int result = hl() + value;
+		f = (uint8_t)((f & 0x8F) | ((((hl() & 0xFFF) + (value & 0xFFF)) > 0xFFF) ? 0x20 : 0) | ((result > 0xFFFF) ? 0x10 : 0));
+		setHL(result);
+	}
+
+	/*The CB prefixed rotates & shifts in opcode order (RLC RRC RL RR SLA SRA SWAP SRL), zero is false for RLCA RRCA RLA
+	& RRA which always clear Z*/
+	uint8_t shift(int operation, uint8_t value, bool zero)
+	{
+		int carry = (f >> 4) & 1, out, result;
+		switch (operation)
+		{
+		case 0: out = value >> 7; result = value << 1 | out; break;
+		case 1: out = value & 1; result = value >> 1 | out << 7; break;
+		case 2: out = value >> 7; result = value << 1 | carry; break;
+		case 3: out = value & 1; result = value >> 1 | carry << 7; break;
+		case 4: out = value >> 7; result = value << 1; break;
+		case 5: out = value & 1; result = value >> 1 | (value & 0x80); break;
+		case 6: out = 0; result = value >> 4 | value << 4; break;
+		default: out = value & 1; result = value >> 1; break;
+		}
+
+		result &= 0xFF;
+		f = (uint8_t)((f & 0x0F) | ((zero && result == 0) ? 0x80 : 0) | out << 4);
+		return (uint8_t)result;
+	}
+
+	//BIT: H set, N cleared, C kept
+	void bit(int index, uint8_t value)
+	{
+		f = (uint8_t)((f & 0x1F) | 0x20 | (((value >> index) & 1) ? 0 : 0x80));
+	}
+
+	//CPL SCF & CCF
+	void cpl() { a = (uint8_t)~a; f |= 0x60; }
+	void scf() { f = (uint8_t)((f & 0x8F) | 0x10); }
+	void ccf() { f = (uint8_t)((f & 0x9F) ^ 0x10); }
+};
+
+//a load the generated code can't work out when it's compiled, only echo ram, oam's gap & the joypad go through the emulator
+inline uint8_t aotRead(Emulator * emu, const AotRuntime & runtime, const AotFrame & frame, int address)
+{
+	if (address < 0xF000)
+		return frame.readPages[address >> 12][address & 0xFFF];
+	if (address >= 0xFE00 && address != 0xFF00)
+		return frame.memory[address];
+	return runtime.read(emu, address);
+}
+
+//whether a store can go straight into memory: work & high ram that no cached block covers
+inline bool aotPlainRam(const AotFrame & frame, int address)
+{
+	return ((address >= 0xC000 && address < 0xE000) || (address >= 0xFF80 && address != 0xFFFF)) && !frame.ramCode[address - 0xC000];
+}
+
+//the same as a compiled jit block (see JitFunction), only ever entered at the block's first instruction
+typedef void (*AotBlockFunction)(Emulator * emu, int quiet, int entry);
+
+struct AotBlock
+{
+	uint32_t key; //rom bank << 16 | address, same as the block cache
+	AotBlockFunction code;
+};
+
+//exported by the module as gb_aot_module
+struct AotModule
+{
+	uint32_t version;
+	uint64_t romChecksum; //has to match the loaded rom (see Emulator::romChecksum)
+	uint32_t blockCount;
+	const AotBlock * blocks;
+
+	//hands the module what it calls back into the emulator with before any of its blocks run
+	void (*bind)(const AotRuntime * runtime);
+};
+
+//only changes if the layout above does, instructions are passed by opcode so modules outlive rebuilds
+const uint32_t AOT_MODULE_VERSION = 3;
@@ -0,0 +1,563 @@
+#include "BlockCache.h"
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//translation cache file layout, a header followed by one entry per rom block
+struct TranslationCacheHeader
+{
+	char magic[4]; //GBTC
+	uint32_t count;
+	uint64_t buildID;
+	uint64_t romChecksum;
+};
+
+struct TranslationCacheEntry
+{
+	uint32_t key; //rom bank << 16 | address
+	uint16_t end;
+	uint16_t hot;
+};
+
+//changes whenever BlockCache.cpp gets rebuilt so a cache is never loaded by a build that didn't write it
+static uint64_t buildID()
+{
+	const char * stamp = __DATE__ " " __TIME__;
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char * c = stamp; *c; c++)
+		hash = (hash ^ (Byte)*c) * 1099511628211ULL;
+
+	return hash ^ sizeof(TranslationCacheEntry) ^ ((uint64_t)sizeof(MicroOp) << 32);
+}
+
+//unconditional jumps, calls & returns, halt, stop & the opcodes that don't exist
+static bool endsBlock(Byte code)
+{
+	switch (code)
+	{
+	case 0x10: case 0x18: case 0x76: //STOP, JR, HALT
+	case 0xC3: case 0xE9: //JP
+	case 0xCD: //CALL
+	case 0xC9: case 0xD9: //RET, RETI
+	case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF: //RST
+	case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+		return true;
+	default:
+		return false;
+	}
+}
+
+BlockCache::BlockCache()
+{
+	memset(ramCode, 0, sizeof(ramCode));
+	current = NULL;
+	nextIndex = 0;
+	nextPC = 0;
+	left = false;
+}
+
+const MicroOp * BlockCache::next(const Emulator & emu)
+{
+	Address pc = emu.reg_PC;
+
+	if (current)
+	{
+		if (pc == nextPC && nextIndex < current->ops.size())
+			; //carry on with the block
+		else if (pc == current->start)
+			nextIndex = 0; //looped back to the start
+		else
+			current = NULL;
+	}
+
+	if (current == NULL)
+	{
+		current = find(emu, true);
+		if (current == NULL)
+			return NULL;
+
+		nextIndex = 0;
+	}
+
+	const MicroOp * op = &current->ops[nextIndex++];
+	nextPC = pc + op->length;
+	return op;
+}
+
+//the block starting at the PC, decoded if it isn't cached yet (or NULL if decode is false)
+BlockCache::Block * BlockCache::find(const Emulator & emu, bool decode)
+{
+	Address pc = emu.reg_PC;
+	uint32_t key;
+	Address regionEnd;
+
+	if (pc < 0x4000)
+	{
+		key = pc; regionEnd = 0x4000;
+	}
+	else if (pc < 0x8000)
+	{
+		key = ((uint32_t)emu.currentRomBank << 16) | pc; regionEnd = 0x8000;
+	}
+	else if (pc >= 0xC000 && pc < 0xE000)
+	{
+		key = pc; regionEnd = 0xE000;
+	}
+	else if (pc >= 0xFF80 && pc < 0xFFFF)
+	{
+		key = pc; regionEnd = 0xFFFF;
+	}
+	else
+		return NULL;
+
+	auto found = blocks.find(key);
+	if (found != blocks.end())
+		return &found->second;
+
+	return decode ? this->decode(emu, pc, key, regionEnd) : NULL;
+}
+
+JitFunction BlockCache::native(const Emulator & emu, JitArena & arena, int & entry)
+{
+	if (current && emu.reg_PC == nextPC && nextIndex < current->ops.size())
+	{
+		if (current->code == NULL || !current->entryPoints[nextIndex])
+			return NULL; //carry on interpreting it until somewhere it can be entered
+
+		entry = (int)nextIndex;
+		left = false;
+		return current->code;
+	}
+
+	//blocks only get decoded by next(), otherwise every instruction interpreted here would start its own block
+	Block * block = find(emu, false);
+	if (block == NULL)
+		return NULL;
+
+	if (block->code == NULL)
+	{
+		if (++block->entries < JIT_THRESHOLD)
+			return NULL;
+
+		block->code = arena.compile(emu, block->ops, block->key, block->entryPoints);
+		if (block->code == NULL) //out of room, start again with whatever is hot from now on
+		{
+			arena.reset();
+			for (auto & cached : blocks)
+			{
+				if (!cached.second.pinned)
+					cached.second.code = NULL;
+			}
+
+			block->code = arena.compile(emu, block->ops, block->key, block->entryPoints);
+			if (block->code == NULL)
+				return NULL;
+		}
+	}
+
+	current = block;
+	nextIndex = 0;
+	nextPC = block->start;
+	entry = 0;
+	left = false;
+	return block->code;
+}
+
+void BlockCache::leaveNative(const Emulator & emu)
+{
+	//it switched the rom bank or wrote over the block's ram, which may have thrown the block away
+	if (left)
+	{
+		leaveBlock();
+		return;
+	}
+
+	//jit blocks can jump straight into each other, the one the code left from is the one to carry on with
+	if (emu.nativeKey != ~0u && (current == NULL || current->key != emu.nativeKey))
+	{
+		auto found = blocks.find(emu.nativeKey);
+		bool mapped = (Address)emu.nativeKey < 0x4000 || (Address)emu.nativeKey >= 0x8000 || (emu.nativeKey >> 16) == emu.currentRomBank;
+		current = (found != blocks.end() && mapped) ? &found->second : NULL;
+	}
+
+	if (current && emu.reg_PC >= current->start && emu.reg_PC < current->end)
+	{
+		Address pc = current->start;
+		for (size_t i = 0; i < current->ops.size(); pc += current->ops[i++].length)
+		{
+			if (pc == emu.reg_PC)
+			{
+				nextIndex = i;
+				nextPC = pc;
+				return;
+			}
+		}
+	}
+
+	leaveBlock();
+}
+
+BlockCache::Block * BlockCache::decode(const Emulator & emu, Address pc, uint32_t key, Address regionEnd)
+{
+	Block block;
+	block.key = key;
+	block.start = pc;
+	block.entries = 0;
+	block.code = NULL;
+	block.pinned = false;
+
+	Address address = pc;
+	while (block.ops.size() < MAX_BLOCK_OPS)
+	{
+		Byte code = codeByte(emu, key, address);
+		int length = emulator_opcode_length(code);
+
+		if (address + length > regionEnd) //would run off the end of the bank/ram
+			break;
+
+		MicroOp op;
+		op.handler = Emulator::decodedOpcodeTable[code];
+		op.code = code;
+		op.value = (length > 1) ? codeByte(emu, key, address + 1) : 0;
+		op.value2 = (length > 2) ? codeByte(emu, key, address + 2) : 0;
+		op.length = (Byte)length;
+		block.ops.push_back(op);
+
+		address += length;
+		if (endsBlock(code))
+			break;
+	}
+
+	if (block.ops.empty())
+		return NULL;
+
+	block.end = address;
+	Block * added = &(blocks[key] = block);
+
+	if (pc >= 0xC000)
+	{
+		ramBlocks.push_back(key);
+		memset(&ramCode[pc - 0xC000], 1, address - pc);
+	}
+
+	return added;
+}
+
+//the rom block at key, decoded if it isn't cached yet
+BlockCache::Block * BlockCache::decodeRom(const Emulator & emu, uint32_t key)
+{
+	Address pc = (Address)key;
+	if (pc >= 0x8000)
+		return NULL;
+
+	auto found = blocks.find(key);
+	if (found != blocks.end())
+		return &found->second;
+
+	return decode(emu, pc, key, (pc < 0x4000) ? 0x4000 : 0x8000);
+}
+
+std::vector<uint32_t> BlockCache::walk(const Emulator & emu, std::vector<uint32_t> seeds)
+{
+	std::vector<uint32_t> found;
+	std::unordered_map<uint32_t, bool> seen;
+
+	for (const auto & cached : blocks)
+	{
+		if (cached.second.start < 0x8000)
+			seeds.push_back(cached.first);
+	}
+
+	while (!seeds.empty())
+	{
+		uint32_t key = seeds.back();
+		seeds.pop_back();
+		if (seen[key])
+			continue;
+		seen[key] = true;
+
+		const Block * block = decodeRom(emu, key);
+		if (block == NULL)
+			continue;
+		found.push_back(key);
+
+		uint32_t bank = key >> 16;
+		Address pc = block->start;
+		for (const MicroOp & op : block->ops)
+		{
+			pc += op.length;
+
+			int target = -1;
+			switch (op.code)
+			{
+			case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA: //JP
+			case 0xCD: case 0xC4: case 0xCC: case 0xD4: case 0xDC: //CALL
+				target = op.value | (op.value2 << 8);
+				break;
+			case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: //JR
+				target = (Address)(pc + (Byte_Signed)op.value);
+				break;
+			case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF: //RST
+				target = op.code & 0x38;
+				break;
+			}
+
+			if (target >= 0 && target < 0x4000)
+				seeds.push_back(target);
+			else if (target >= 0x4000 && target < 0x8000 && bank != 0)
+				seeds.push_back((bank << 16) | target);
+		}
+
+		//carries on after a call/restart returns, halt/stop wake up, a conditional branch isn't taken or a block hit MAX_BLOCK_OPS
+		Byte last = block->ops.back().code;
+		bool returns = last == 0xCD || (last & 0xC7) == 0xC7 || last == 0x76 || last == 0x10;
+		if ((returns || !endsBlock(last)) && block->end < ((block->start < 0x4000) ? 0x4000 : 0x8000))
+			seeds.push_back((key & 0xFFFF0000) | block->end);
+	}
+
+	return found;
+}
+
+const std::vector<MicroOp> * BlockCache::blockOps(uint32_t key) const
+{
+	auto found = blocks.find(key);
+	return (found != blocks.end()) ? &found->second.ops : NULL;
+}
+
+bool BlockCache::install(const Emulator & emu, uint32_t key, JitFunction code)
+{
+	if (!validRomKey(emu, key))
+		return false;
+
+	Block * block = decodeRom(emu, key);
+	if (block == NULL)
+		return false;
+
+	block->code = code;
+	block->entryPoints.assign(block->ops.size(), false);
+	block->entryPoints[0] = true;
+	block->pinned = true;
+	return true;
+}
+
+/*Keys that come from outside (a .tcache file or an aot module) have to point into the rom: below 0x8000, no bank 
+outside 0x4000-0x7FFF & a bank the cartridge actually has, codeByte doesn't check*/
+bool BlockCache::validRomKey(const Emulator & emu, uint32_t key)
+{
+	Address address = (Address)key;
+	uint32_t bank = key >> 16;
+	if (address >= 0x8000)
+		return false;
+	if (address < 0x4000)
+		return bank == 0;
+	return (size_t)bank * 0x4000 + 0x4000 <= emu.cartridgeMemory.size();
+}
+
+//reads from the block's own rom bank, which isn't necessarily the one switched in (see load)
+Byte BlockCache::codeByte(const Emulator & emu, uint32_t key, Address address)
+{
+	if (address >= 0x4000 && address < 0x8000)
+		return emu.cartridgeMemory[(key >> 16) * 0x4000 + (address - 0x4000)];
+
+	//straight from the page so a block decoded during an oam dma doesn't get what the bus returns
+	return emu.peekCode(address);
+}
+
+//drops every ram block containing address
+void BlockCache::invalidate(Address address)
+{
+	for (size_t i = 0; i < ramBlocks.size();)
+	{
+		const Block & block = blocks[ramBlocks[i]];
+		if (address >= block.start && address < block.end)
+		{
+			blocks.erase(ramBlocks[i]);
+			ramBlocks[i] = ramBlocks.back();
+			ramBlocks.pop_back();
+		}
+		else
+			i++;
+	}
+
+	leaveBlock();
+	markRamCode();
+}
+
+void BlockCache::markRamCode()
+{
+	memset(ramCode, 0, sizeof(ramCode));
+	for (uint32_t key : ramBlocks)
+	{
+		const Block & block = blocks[key];
+		memset(&ramCode[block.start - 0xC000], 1, block.end - block.start);
+	}
+}
+
+bool BlockCache::save(const char * path, uint64_t romChecksum) const
+{
+	std::vector<TranslationCacheEntry> entries;
+	for (const auto & cached : blocks)
+	{
+		const Block & block = cached.second;
+		if (block.start >= 0x8000) //ram code can be anything by the next launch
+			continue;
+
+		TranslationCacheEntry entry;
+		entry.key = cached.first;
+		entry.end = block.end;
+		entry.hot = (block.code != NULL || block.entries >= JIT_THRESHOLD) ? 1 : 0;
+		entries.push_back(entry);
+	}
+
+	TranslationCacheHeader header;
+	memcpy(header.magic, "GBTC", 4);
+	header.count = (uint32_t)entries.size();
+	header.buildID = buildID();
+	header.romChecksum = romChecksum;
+
+	FILE * out;
+	if (fopen_s(&out, path, "wb") != 0 || out == NULL)
+		return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+		fwrite(entries.data(), sizeof(TranslationCacheEntry), entries.size(), out) == entries.size();
+	fclose(out);
+	return written;
+}
+
+int BlockCache::load(const char * path, uint64_t romChecksum, const Emulator & emu, JitArena * arena)
+{
+	//mapped read only where that's available, read in one go otherwise
+	std::vector<Byte> buffer;
+	const Byte * data = NULL;
+	size_t size = 0;
+
+#ifdef _WIN32
+	FILE * in;
+	if (fopen_s(&in, path, "rb") != 0 || in == NULL)
+		return 0;
+
+	fseek(in, 0, SEEK_END);
+	buffer.resize((size_t)ftell(in));
+	fseek(in, 0, SEEK_SET);
+	size = fread(buffer.data(), 1, buffer.size(), in);
+	fclose(in);
+	data = buffer.data();
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return 0;
+
+	struct stat info;
+	void * mapped = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+		mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (mapped == MAP_FAILED)
+		return 0;
+
+	data = (const Byte *)mapped;
+	size = (size_t)info.st_size;
+#endif
+
+	int loaded = 0;
+	const TranslationCacheHeader * header = (const TranslationCacheHeader *)data;
+
+	if (size >= sizeof(TranslationCacheHeader) && memcmp(header->magic, "GBTC", 4) == 0 &&
+		header->buildID == buildID() && header->romChecksum == romChecksum &&
+		size >= sizeof(TranslationCacheHeader) + header->count * sizeof(TranslationCacheEntry))
+	{
+		const TranslationCacheEntry * entries = (const TranslationCacheEntry *)(header + 1);
+		for (uint32_t i = 0; i < header->count; i++)
+		{
+			uint32_t key = entries[i].key;
+			if (!validRomKey(emu, key) || blocks.count(key) != 0)
+				continue;
+
+			Block * block = decodeRom(emu, key);
+			if (block == NULL || block->end != entries[i].end) //shouldn't happen for the same rom & build
+				continue;
+
+			if (entries[i].hot)
+			{
+				block->entries = JIT_THRESHOLD;
+				if (arena)
+					block->code = arena->compile(emu, block->ops, block->key, block->entryPoints);
+			}
+			loaded++;
+		}
+	}
+
+#ifndef _WIN32
+	munmap((void *)data, size);
+#endif
+	return loaded;
+}
+
+void Emulator::setCpuEngine(CpuEngine engine)
+{
+	delete blockCache;
+	delete jit;
+	blockCache = (engine != CPU_INTERPRETER) ? new BlockCache() : NULL;
+	jit = NULL;
+
+	//without x86-64 (or executable memory) nothing gets compiled, only blocks from an aot module run natively
+	if (engine == CPU_JIT)
+		jit = new JitArena(JIT_ARENA_SIZE);
+}
+
+void Emulator::setTranslationCache(bool enabled)
+{
+	translationCache = enabled;
+}
+
+void Emulator::loadTranslationCache(const char * romLocation)
+{
+	if (!translationCache || blockCache == NULL)
+		return;
+
+	translationCachePath = std::string(romLocation) + ".tcache";
+	int loaded = blockCache->load(translationCachePath.c_str(), romChecksum(), *this, jit);
+	if (loaded > 0)
+		printf("translation cache: %d blocks from %s\n", loaded, translationCachePath.c_str());
+}
+
+void Emulator::saveTranslationCache()
+{
+	if (translationCachePath.empty() || blockCache == NULL)
+		return;
+
+	if (!blockCache->save(translationCachePath.c_str(), romChecksum()))
+		printf("translation cache: couldn't write %s\n", translationCachePath.c_str());
+}
+
+//FNV-1a over the rom, its size comes from the cartridge header (32KB << n)
+uint64_t Emulator::romChecksum() const
+{
+	size_t size = (cartridgeMemory[0x148] <= 6) ? (size_t)0x8000 << cartridgeMemory[0x148] : cartridgeMemory.size();
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size && i < cartridgeMemory.size(); i++)
+		hash = (hash ^ cartridgeMemory[i]) * 1099511628211ULL;
+
+	return hash;
+}
+
+void Emulator::executeCachedOpcode()
+{
+	const MicroOp * op = blockCache->next(*this);
+	if (op == NULL)
+	{
+		executeNextOpcode();
+		return;
+	}
+
+	//copied first, writing to ram can throw away the block it came from
+	MicroOp decoded = *op;
+	(this->*decoded.handler)(decoded.value, decoded.value2);
+}
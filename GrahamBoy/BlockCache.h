@@ -0,0 +1,110 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "types.h"
+#include "Emulator.h"
+#include "Jit.h"
+
+//one decoded instruction, its operands were fetched when the block was built
+struct MicroOp
+{
+	Emulator::DecodedOpcodeHandler handler;
+	Byte code;
+	Byte value;
+	Byte value2;
+	Byte length;
+};
+
+/*The second cpu engine: runs of instructions get decoded once into blocks of micro ops & cached per 
+(rom bank, address), so running them again skips fetching & decoding every instruction. Blocks only end 
+at unconditional jumps/calls/returns, a conditional one that is taken just leaves the block early. The rest 
+of the hardware still gets stepped after every instruction so the results are the same as the interpreter.
+
+Blocks are cached for rom (bank 0 & the switchable bank), work ram (0xC000-0xDFFF) & high ram (0xFF80-0xFFFE). 
+Rom never changes, writing to a ram byte that's part of a block throws away the blocks covering it. Code 
+anywhere else (cart ram, vram, echo ram) is just interpreted.*/
+class BlockCache
+{
+public:
+	BlockCache();
+
+	//the micro op for the instruction at the PC, NULL if it isn't somewhere blocks get cached
+	const MicroOp * next(const Emulator & emu);
+
+	/*CPU_JIT: the compiled code for the block starting at the PC, NULL if there isn't one or it isn't hot yet. 
+	Blocks get compiled once they've been entered JIT_THRESHOLD times. Partway through a block (after compiled code 
+	was stopped, or while the interpreter had to take over) it's the block's code again if it can be entered at the 
+	PC, entry is the instruction to enter it at.*/
+	JitFunction native(const Emulator & emu, JitArena & arena, int & entry);
+
+	//after the code native() handed out returns, the interpreter carries on with the block from wherever it stopped
+	void leaveNative(const Emulator & emu);
+
+	//the instructions after the current one can't be trusted anymore (e.g. a different rom bank got switched in)
+	void leaveBlock() { current = NULL; left = true; }
+
+	//whether the block being run natively had to be left since native() handed it out
+	bool hasLeft() const { return left; }
+
+	void ramWritten(Address address)
+	{
+		if (ramCode[address - 0xC000])
+			invalidate(address);
+	}
+
+	//compiled code checks it for the ram it writes to itself (see Jit.h)
+	const bool * ramCodeMap() const { return ramCode; }
+
+	size_t blockCount() const { return blocks.size(); }
+
+	/*The translation cache: the rom blocks (& which of them were hot) get saved when the emulator closes & 
+	decoded/compiled straight away on the next launch instead of warming up again. The file is only used if 
+	it was written for the same rom by the same build. load returns how many blocks it brought back.*/
+	bool save(const char * path, uint64_t romChecksum) const;
+	int load(const char * path, uint64_t romChecksum, const Emulator & emu, JitArena * arena);
+
+	/*Ahead of time compilation (see Aot.h): decodes every rom block reachable from the seeds (& any rom blocks 
+	that are already cached) by following jumps, 
+	calls, restarts & fall throughs and returns their keys in the order they were found. Jumps from bank 0 into 
+	the switchable bank are skipped since which bank is there isn't known until the game runs.*/
+	std::vector<uint32_t> walk(const Emulator & emu, std::vector<uint32_t> seeds);
+	const std::vector<MicroOp> * blockOps(uint32_t key) const;
+
+	//code compiled somewhere else for the rom block at key, it's kept when the jit's arena gets reset
+	bool install(const Emulator & emu, uint32_t key, JitFunction code);
+
+private:
+	static const size_t MAX_BLOCK_OPS = 64;
+	static const uint32_t JIT_THRESHOLD = 16;
+
+	struct Block
+	{
+		uint32_t key;
+		Address start;
+		Address end; //one past the last byte
+		std::vector<MicroOp> ops;
+		uint32_t entries;
+		JitFunction code;
+		std::vector<bool> entryPoints; //which of the ops code can be entered at
+		bool pinned; //code came from an ahead of time module, not the arena
+	};
+
+	std::unordered_map<uint32_t, Block> blocks; //key is rom bank << 16 | address, bank is 0 outside 0x4000-0x7FFF
+	std::vector<uint32_t> ramBlocks;
+	bool ramCode[0x4000]; //0xC000-0xFFFF, set for every byte that's part of a cached block
+
+	//where the instructions are currently coming from
+	const Block * current;
+	size_t nextIndex;
+	Address nextPC;
+	bool left;
+
+	Block * find(const Emulator & emu, bool decode);
+	Block * decode(const Emulator & emu, Address pc, uint32_t key, Address regionEnd);
+	Block * decodeRom(const Emulator & emu, uint32_t key);
+	static Byte codeByte(const Emulator & emu, uint32_t key, Address address);
+	static bool validRomKey(const Emulator & emu, uint32_t key);
+	void invalidate(Address address);
+	void markRamCode();
+};
@@ -0,0 +1,299 @@
+#include "CopyLoop.h"
+#include "Emulator.h"
+#include "BlockCache.h"
+#include <string.h>
+
+CopyLoop::CopyLoop()
+{
+	state = LOOP_WATCHING;
+	start = jump = 0;
+	nextPC = 0;
+	startCycles = 0;
+	iterationCycles = 0;
+	jumpCycles = 0;
+	source = destination = PAIR_NONE;
+	sourceStep = destinationStep = 0;
+	counter = -1;
+	wideCounter = PAIR_NONE;
+	rejectedStart = rejectedJump = 0;
+	rejectedBank = 0;
+}
+
+//everything from start up to jump has to fit the shape described in CopyLoop.h
+bool CopyLoop::match(const Emulator & emu)
+{
+	int steps[3] = { 0, 0, 0 }; //how far each pair moves in an iteration
+	int loads = 0, stores = 0, ops = 0;
+	int tested[2] = { -1, -1 }; //ld a,r; or r
+
+	source = destination = PAIR_NONE;
+	counter = -1;
+	wideCounter = PAIR_NONE;
+
+	Address pc = start;
+	while (pc < jump)
+	{
+		if (++ops > MAX_LOOP_OPS)
+			return false;
+
+		Byte code = emu.peekCode(pc);
+		switch (code)
+		{
+		case 0x0A: case 0x1A: case 0x2A: case 0x3A: case 0x7E: //ld a,[bc] / [de] / [hl+] / [hl-] / [hl]
+			if (loads++ > 0 || stores > 0)
+				return false;
+			source = (code == 0x0A) ? PAIR_BC : (code == 0x1A) ? PAIR_DE : PAIR_HL;
+			steps[source] += (code == 0x2A) ? 1 : (code == 0x3A) ? -1 : 0;
+			break;
+
+		case 0x02: case 0x12: case 0x22: case 0x32: case 0x77: //ld [bc] / [de] / [hl+] / [hl-] / [hl],a
+			if (stores++ > 0)
+				return false;
+			destination = (code == 0x02) ? PAIR_BC : (code == 0x12) ? PAIR_DE : PAIR_HL;
+			steps[destination] += (code == 0x22) ? 1 : (code == 0x32) ? -1 : 0;
+			break;
+
+		case 0x03: case 0x13: case 0x23: //inc rr
+			steps[code >> 4]++;
+			break;
+
+		case 0x0B: case 0x1B: case 0x2B: //dec rr, a pointer going down or the 16 bit counter
+			steps[code >> 4]--;
+			break;
+
+		case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: //dec r, has to set the flags for the jump
+			if (counter >= 0 || pc + 1 != jump)
+				return false;
+			counter = ((code >> 3) & 7) ^ 1; //registers are stored C B E D L H
+			break;
+
+		case 0x78: case 0x79: case 0x7A: case 0x7B: case 0x7C: case 0x7D: //ld a,r right before or r
+			if (tested[0] >= 0 || pc + 2 != jump)
+				return false;
+			tested[0] = (code & 7) ^ 1;
+			break;
+
+		case 0xB0: case 0xB1: case 0xB2: case 0xB3: case 0xB4: case 0xB5: //or r right before the jump
+			if (tested[0] < 0 || pc + 1 != jump)
+				return false;
+			tested[1] = (code & 7) ^ 1;
+			break;
+
+		default:
+			return false;
+		}
+
+		pc += emulator_opcode_length(emu.peekCode(pc));
+	}
+
+	Byte code = emu.peekCode(jump);
+	if (pc != jump || jump + 3 - start > MAX_LOOP_BYTES)
+		return false;
+	if (code == 0x20 && (Address)(jump + 2 + (Byte_Signed)emu.peekCode(jump + 1)) != start) //jr nz
+		return false;
+	if (code == 0xC2 && (emu.peekCode(jump + 1) | (emu.peekCode(jump + 2) << 8)) != start) //jp nz
+		return false;
+	if (code != 0x20 && code != 0xC2)
+		return false;
+
+	if (stores != 1 || source == destination)
+		return false;
+
+	if (tested[1] >= 0) //ld a,r; or r has to test both halves of a pair that gets decremented
+	{
+		if ((tested[0] ^ tested[1]) != 1 || steps[tested[0] >> 1] != -1)
+			return false;
+		if (source == PAIR_NONE) //A gets overwritten by the test, a fill wouldn't store the same thing every time
+			return false;
+		wideCounter = (Pair)(tested[0] >> 1);
+		steps[wideCounter] = 0;
+	}
+	else if (counter < 0)
+		return false;
+
+	sourceStep = (source == PAIR_NONE) ? 0 : steps[source];
+	destinationStep = steps[destination];
+
+	//the pointers move by one, nothing else gets touched
+	for (int pair = PAIR_BC; pair <= PAIR_HL; pair++)
+	{
+		if (pair == source || pair == destination)
+		{
+			if (steps[pair] != 1 && steps[pair] != -1)
+				return false;
+		}
+		else if (steps[pair] != 0)
+			return false;
+
+		if ((pair == source || pair == destination) && (pair == wideCounter || pair == counter >> 1))
+			return false;
+	}
+
+	return true;
+}
+
+void CopyLoop::instructionDone(Emulator & emu, int cycles)
+{
+	Address executed = nextPC;
+	nextPC = emu.reg_PC;
+
+	if (state != LOOP_WATCHING)
+	{
+		bool inside = emu.reg_PC >= start && emu.reg_PC <= jump && executed >= start && executed <= jump;
+		bool wentRound = inside && executed == jump && emu.reg_PC == start;
+
+		if (state == LOOP_MEASURING && wentRound && cycles == jumpCycles)
+		{
+			iterationCycles = (int)(emu.totalCycles - startCycles);
+			state = LOOP_FOUND;
+			return;
+		}
+		if (state != LOOP_MEASURING && inside)
+		{
+			state = wentRound ? LOOP_FOUND : LOOP_INSIDE;
+			return;
+		}
+		if (state == LOOP_MEASURING && inside && !wentRound)
+			return;
+
+		state = LOOP_WATCHING; //left it, took an interrupt or the first iteration wasn't like the rest
+	}
+
+	if (emu.reg_PC < executed && executed - emu.reg_PC <= MAX_LOOP_BYTES)
+	{
+		if (emu.reg_PC == rejectedStart && executed == rejectedJump && emu.currentRomBank == rejectedBank)
+			return;
+
+		start = emu.reg_PC;
+		jump = executed;
+
+		if (match(emu))
+		{
+			state = LOOP_MEASURING;
+			startCycles = emu.totalCycles;
+			jumpCycles = cycles;
+		}
+		else if (start < 0x8000) //rom can't change under it
+		{
+			rejectedStart = start;
+			rejectedJump = jump;
+			rejectedBank = emu.currentRomBank;
+		}
+	}
+}
+
+//how many bytes from address to the edge of its page in the direction step goes, 0 if blocks can't go there
+int CopyLoop::room(const Emulator & emu, Word address, int step, bool write)
+{
+	int page = address >> 12;
+
+	if (write && page != 0x8 && page != 0x9 && page != 0xC && page != 0xD) //vram & work ram are just memory
+		return 0;
+	if (!write && emu.readPages[page] == NULL)
+		return 0;
+
+	return (step > 0) ? 0x1000 - (address & 0xFFF) : (address & 0xFFF) + 1;
+}
+
+int CopyLoop::run(Emulator & emu, int budget)
+{
+	Word from = (source == PAIR_NONE) ? 0 : readPair(emu, source);
+	Word to = readPair(emu, destination);
+	Word count = (wideCounter == PAIR_NONE) ? emu.registers[counter] : readPair(emu, wideCounter);
+
+	//iterations left before the counter gets to 0, the last one is left to run normally
+	int iterations = (wideCounter == PAIR_NONE) ? (Byte)(count - 1) : (Word)(count - 1);
+
+	int writable = room(emu, to, destinationStep, true);
+	iterations = (writable < iterations) ? writable : iterations;
+	if (source != PAIR_NONE)
+	{
+		int readable = room(emu, from, sourceStep, false);
+		iterations = (readable < iterations) ? readable : iterations;
+	}
+
+	int quiet = emu.quietCycles(budget, jumpCycles) / iterationCycles;
+	iterations = (quiet < iterations) ? quiet : iterations;
+	if (iterations <= 0)
+		return 0;
+
+	//the bytes that get written, lowest first
+	Word low = (destinationStep > 0) ? to : to - (iterations - 1);
+	if (start >= 0x8000 && low <= jump + 2 && start < low + iterations) //would overwrite its own code
+		return 0;
+
+	if (low < 0xA000)
+		emu.drawPendingLines(); //they have to see vram from before the copy
+
+	Byte * out = &emu.memory[to];
+	Byte a = emu.reg_AF.hi;
+	if (source == PAIR_NONE)
+		memset(&emu.memory[low], a, iterations);
+	else
+	{
+		const Byte * in = emu.readPages[from >> 12] + (from & 0xFFF);
+		bool apart = from + iterations <= low || low + iterations <= from; //pages never alias each other
+
+		if (sourceStep > 0 && destinationStep > 0 && apart)
+			memcpy(out, in, iterations);
+		else //a byte at a time like the loop would, it could be reading what it just wrote
+		{
+			for (int i = 0; i < iterations; i++)
+				out[i * destinationStep] = in[i * sourceStep];
+		}
+		a = out[(iterations - 1) * destinationStep];
+	}
+
+	if (low < 0xA000)
+	{
+		for (int i = 0; i < iterations; i++)
+			emu.tileMaps.written(low + i);
+	}
+
+	if (emu.blockCache && low >= 0xC000)
+	{
+		for (int i = 0; i < iterations; i++)
+			emu.blockCache->ramWritten(low + i);
+	}
+
+	writePair(emu, destination, to + iterations * destinationStep);
+	if (source != PAIR_NONE)
+		writePair(emu, source, from + iterations * sourceStep);
+
+	//the flags the last dec r or or r done here left behind, the lower nibble stays as it is
+	Byte f = emu.computeFlags();
+	if (wideCounter == PAIR_NONE)
+	{
+		Byte before = (Byte)(count - iterations + 1);
+		emu.registers[counter] = before - 1;
+		f = (f & (0x0F | FLAG_CARRY)) | FLAG_SUB | (((before & 0xF) == 0) ? FLAG_HALF_CARRY : 0);
+	}
+	else
+	{
+		Word left = count - iterations;
+		writePair(emu, wideCounter, left);
+		a = (Byte)(left >> 8) | (Byte)left;
+		f &= 0x0F;
+	}
+
+	emu.reg_AF.hi = a;
+	emu.reg_AF.lo = f;
+	emu.lazyOp = Emulator::FLAGS_READY;
+
+	int cycles = iterations * iterationCycles;
+	emu.fastForward(cycles);
+	if (emu.blockCache)
+		emu.blockCache->leaveBlock(); //none of the iterations went through it
+	return cycles;
+}
+
+Word CopyLoop::readPair(const Emulator & emu, Pair pair)
+{
+	return emu.registers[pair * 2] | (emu.registers[pair * 2 + 1] << 8);
+}
+
+void CopyLoop::writePair(Emulator & emu, Pair pair, Word value)
+{
+	emu.registers[pair * 2] = (Byte)value;
+	emu.registers[pair * 2 + 1] = (Byte)(value >> 8);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "types.h"
+
+class Emulator;
+
+/*Finds the loops games copy & clear memory with, like ld a,[hl+]; ld [de],a; inc de; dec c; jr nz (tiles into vram)
+or ld [hl+],a; dec b; jr nz (clearing ram) & does their iterations with memcpy/memset. A short backward jump gets the
+loop matched against that shape: an optional load into A through a register pair, a store of A through another one,
+both pointers moving by one each iteration & either an 8 bit counter (dec r; jr nz) or a 16 bit one (dec rr; ld a,r;
+or r; jr nz). How many cycles an iteration takes is measured by letting it run once.
+
+Every time the loop comes back round to its start as many iterations as possible are done in one go. That's never the
+last one (it falls through & leaves the flags for the game), only while both pointers stay inside one page of plain
+memory (rom, vram or work ram, never io, oam, the mbc registers or the loop's own code) & only as many cycles as the
+hardware stays quiet for (see Emulator::quietCycles). The loop runs normally for whatever's left.*/
+class CopyLoop
+{
+public:
+	CopyLoop();
+
+	//called after every instruction, once the hardware has caught up
+	void instructionDone(Emulator & emu, int cycles);
+
+	//the cpu is at the start of a copy loop
+	bool found() const { return state == LOOP_FOUND; }
+
+	//not in the middle of looking at a loop, so the instructions don't all have to be seen one at a time
+	bool watching() const { return state == LOOP_WATCHING; }
+
+	//the instructions up to executed ran as compiled code (see Emulator::runNative), only that one gets instructionDone
+	void resume(Address executed) { nextPC = executed; }
+
+	//does as many iterations as it can without going past budget cycles, returns the cycles they took (0 if it can't)
+	int run(Emulator & emu, int budget);
+
+private:
+	static const int MAX_LOOP_OPS = 8;
+	static const int MAX_LOOP_BYTES = 16;
+
+	enum State
+	{
+		LOOP_WATCHING,
+		LOOP_MEASURING, //running the first iteration to see how long it takes
+		LOOP_INSIDE, //somewhere in a measured loop
+		LOOP_FOUND //back at its start
+	};
+
+	//register pairs, the low byte is registers[pair * 2] (see Emulator::registers)
+	enum Pair
+	{
+		PAIR_BC,
+		PAIR_DE,
+		PAIR_HL,
+		PAIR_NONE = -1
+	};
+
+	State state;
+	Address start;
+	Address jump; //the conditional jump back to start
+	Address nextPC; //where the cpu was after the last instruction, i.e. where the next one starts
+	uint64_t startCycles;
+	int iterationCycles;
+	int jumpCycles;
+
+	//what an iteration does
+	Pair source; //PAIR_NONE for a fill, which stores A every time
+	Pair destination;
+	int sourceStep; //+1 or -1
+	int destinationStep;
+	int counter; //registers index of an 8 bit counter
+	Pair wideCounter; //or the pair holding a 16 bit one
+
+	//the last loop that didn't match, so it doesn't get decoded again on every iteration
+	Address rejectedStart;
+	Address rejectedJump;
+	Byte rejectedBank;
+
+	bool match(const Emulator & emu);
+
+	static int room(const Emulator & emu, Word address, int step, bool write);
+
+	static Word readPair(const Emulator & emu, Pair pair);
+	static void writePair(Emulator & emu, Pair pair, Word value);
+};
@@ -4,6 +4,93 @@
 #include <stdio.h>
 #include <iostream>
 
+/*Flag tables for the 8 bit alu, generated at compile time. Full operand x operand tables (64K+ entries) are 
+more than constexpr evaluation allows, so the half carries come from the low nibbles (& carry in) and the 
+rest from the result: 
+	half carry: indexed by carry << 8 | target nibble << 4 | value nibble
+	inc/dec: the Z N H flags, indexed by the value before the inc/dec
+	daa: new A << 8 | new flags, indexed by N H C << 4 | A*/
+template <int N, class T = Byte>
+struct FlagTable
+{
+	T entries[N];
+	constexpr T operator[](int i) const { return entries[i]; }
+};
+
+static constexpr FlagTable<512> makeHalfCarryTable(bool subtract)
+{
+	FlagTable<512> table = {};
+	for (int i = 0; i < 512; i++)
+	{
+		int carry = i >> 8, target = (i >> 4) & 0xF, value = i & 0xF;
+		bool half = subtract ? (target - value - carry < 0) : (target + value + carry > 0xF);
+		table.entries[i] = half ? FLAG_HALF_CARRY : 0;
+	}
+	return table;
+}
+
+static constexpr FlagTable<256> makeIncDecTable(bool decrement)
+{
+	FlagTable<256> table = {};
+	for (int i = 0; i < 256; i++)
+	{
+		Byte result = (Byte)(decrement ? i - 1 : i + 1);
+		Byte f = decrement ? FLAG_SUB : 0;
+		if (result == 0) f |= FLAG_ZERO;
+		if ((i & 0xF) == (decrement ? 0x0 : 0xF)) f |= FLAG_HALF_CARRY;
+		table.entries[i] = f;
+	}
+	return table;
+}
+
+//https://ehaskins.com/2018-01-30%20Z80%20DAA/ --> explains DAA instruction
+static constexpr FlagTable<2048, Word> makeDaaTable()
+{
+	FlagTable<2048, Word> table = {};
+	for (int i = 0; i < 2048; i++)
+	{
+		Byte f = (Byte)((i >> 4) & (FLAG_SUB | FLAG_HALF_CARRY | FLAG_CARRY));
+		bool add = !(f & FLAG_SUB); //check if the previous operation was a subtract (0 means it was an add)
+		bool carry = (f & FLAG_CARRY) != 0;
+		bool half_carry = (f & FLAG_HALF_CARRY) != 0;
+
+		Word result = (Word)(i & 0xFF);
+		Word correction = (carry) ? 0x60 : 0x00; //if there was a carry need to add 60 (or 6 to the second digit)
+
+		if (half_carry || (add && ((result & 0x0F) > 9)))
+			correction |= 0x06; //there was half carry or the value is greater than 9
+
+		if (carry || (add && (result > 0x99)))
+			correction |= 0x60;
+
+		if (add)
+			result += correction; //for adding need to add correction
+		else
+			result -= correction; //o/w subtract
+
+		if (((correction << 2) & 0x100) != 0) //check if there was a carry and is greather than 0x99
+			f |= FLAG_CARRY;
+
+		f &= ~FLAG_HALF_CARRY;
+		if ((result & 0xFF) == 0)
+			f |= FLAG_ZERO;
+
+		table.entries[i] = (Word)(((result & 0xFF) << 8) | f);
+	}
+	return table;
+}
+
+static constexpr FlagTable<512> s_addHalfCarry = makeHalfCarryTable(false);
+static constexpr FlagTable<512> s_subHalfCarry = makeHalfCarryTable(true);
+static constexpr FlagTable<256> s_incFlags = makeIncDecTable(false);
+static constexpr FlagTable<256> s_decFlags = makeIncDecTable(true);
+static constexpr FlagTable<2048, Word> s_daaTable = makeDaaTable();
+
+static inline int halfCarryIndex(Byte target, Byte value, Byte carry)
+{
+	return (carry << 8) | ((target & 0xF) << 4) | (value & 0xF);
+}
+
 //takes in the pc and increments it, also intakes the num of cycles for each PC instruction
 void Emulator::op(int pc, int cycle)
 {
@@ -14,8 +101,65 @@ void Emulator::op(int pc, int cycle)
 
 }
 
+void Emulator::setLazyFlags(Byte operation, Byte target, Byte value, Byte carry, Byte result)
+{
+	lazyOp = operation;
+	lazyTarget = target;
+	lazyValue = value;
+	lazyCarry = carry;
+	lazyResult = result;
+}
+
+//what F is once the pending alu op (if any) is applied, the lower nibble is kept as is like set_flag does
+Byte Emulator::computeFlags() const
+{
+	Byte a = lazyTarget, b = lazyValue, c = lazyCarry;
+	Byte f = reg_AF.lo & 0x0F;
+	Byte zero = (lazyResult == 0) ? FLAG_ZERO : 0;
+
+	switch (lazyOp)
+	{
+	case LAZY_ADD: case LAZY_ADC:
+		return f | zero | s_addHalfCarry[halfCarryIndex(a, b, c)] | ((a + b + c > 0xFF) ? FLAG_CARRY : 0);
+
+	//sub & cp: the result is only 0 when a == b
+	case LAZY_SUB: case LAZY_SBC:
+		return f | FLAG_SUB | zero | s_subHalfCarry[halfCarryIndex(a, b, c)] | ((a < b + c) ? FLAG_CARRY : 0);
+
+	case LAZY_AND:
+		return f | FLAG_HALF_CARRY | zero;
+
+	case LAZY_OR_XOR:
+		return f | zero;
+
+	//INC & DEC leave the carry alone, it was made ready before they were recorded
+	case LAZY_INC:
+		return (reg_AF.lo & (0x0F | FLAG_CARRY)) | s_incFlags[a];
+
+	case LAZY_DEC:
+		return (reg_AF.lo & (0x0F | FLAG_CARRY)) | s_decFlags[a];
+
+	default:
+		return reg_AF.lo;
+	}
+}
+
+//makes F up to date & returns it, anything that reads the flags has to go through here
+Byte Emulator::flags()
+{
+	if (lazyOp != FLAGS_READY)
+	{
+		reg_AF.lo = computeFlags();
+		lazyOp = FLAGS_READY;
+	}
+
+	return reg_AF.lo;
+}
+
 void Emulator::set_flag(int flag, bool value)
 {
+	flags(); //the other flags have to be ready before changing just some of them
+
 	if (value)
 		reg_AF.lo |= flag; //or means to keep the others the same value (or w/ 0) but turn on the bit we want (or w/ 1)
 	else
@@ -29,13 +173,17 @@ void Emulator::LD(Byte& destination, Byte value)
 }
 
 //used to read the contents of an address in memory [LDH A,(n)]
+template <class Timing>
 void Emulator::LD(Byte& destination, Address addr)
 {
+	Timing::machineCycle(*this);
 	destination = readMemory(addr);
 }
 
+template <class Timing>
 void Emulator::LD(Address addr, Byte value)
 {
+	Timing::machineCycle(*this);
 	writeMemory(addr, value);
 }
 
@@ -64,213 +212,131 @@ void Emulator::LDHL(Byte value)
 }
 
 //load (nn), SP
+template <class Timing>
 void Emulator::LDNN(Byte low, Byte high)
 {
 	Byte lowSP = (Byte)reg_SP;
 	Byte highSP = (Byte)(reg_SP >> 8);
 
 	Address location = (high << 8) | low;
+	Timing::machineCycle(*this);
 	writeMemory(location, lowSP);
+	Timing::machineCycle(*this);
 	writeMemory(location + 1, highSP);
 
 }
 
+template <class Timing>
 void Emulator::PUSH(Byte high, Byte low)
 {
+	Timing::machineCycle(*this); //SP gets decremented first
 	reg_SP--;
+	Timing::machineCycle(*this);
 	writeMemory(reg_SP, high);
 	reg_SP--;
+	Timing::machineCycle(*this);
 	writeMemory(reg_SP, low);
 
 }
 
+template <class Timing>
 void Emulator::POP(Byte& high, Byte& low)
 {
+	Timing::machineCycle(*this);
 	low = readMemory(reg_SP);
 	reg_SP++;
+	Timing::machineCycle(*this);
 	high = readMemory(reg_SP);
 	reg_SP++;
 }
 
 void Emulator::ADD(Byte& target, Byte value)
 {
-	Word result = target + value;
-
-	set_flag(FLAG_ZERO, (result & 0xFF) == 0);
-	set_flag(FLAG_SUB, false);
-	set_flag(FLAG_HALF_CARRY, ((value & 0xF) + (target & 0xF)) > 0x0F);
-	set_flag(FLAG_CARRY, result > 0xFF);
-
-	target = (Byte)(result & 0xFF);
-}
-
-//add from an address [HL?]
-void Emulator::ADD(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	ADD(target, value);
+	Byte result = (Byte)(target + value);
+	setLazyFlags(LAZY_ADD, target, value, 0, result);
+	target = result;
 }
 
 void Emulator::ADC(Byte& target, Byte value)
 {
-	Word carry = (reg_AF.lo & 0x10) >> 4;
-	Word result = target + value + carry;
-
-	set_flag(FLAG_ZERO, (result & 0xFF) == 0);
-	set_flag(FLAG_SUB, false);
-	set_flag(FLAG_HALF_CARRY, ((value & 0xF) + (target & 0xF) + (Byte)carry) & 0x10);
-	set_flag(FLAG_CARRY, result > 0xFF);
-
-	target = (Byte)(result & 0xFF);
-}
-
-//add from an address [HL?]
-void Emulator::ADC(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	ADC(target, value);
+	Byte carry = (flags() & 0x10) >> 4;
+	Byte result = (Byte)(target + value + carry);
+	setLazyFlags(LAZY_ADC, target, value, carry, result);
+	target = result;
 }
 
 void Emulator::SUB(Byte& target, Byte value)
 {
-	Word_Signed result = (Word_Signed)target - (Word_Signed)value;
-	Byte_Signed sTarget = (Byte_Signed)target;
-	Byte_Signed sValue = (Byte_Signed)value;
-
-	set_flag(FLAG_ZERO, result == 0);
-	set_flag(FLAG_SUB, true);
-	set_flag(FLAG_HALF_CARRY, (sTarget & 0xF) < (sValue & 0xF)); //check if subtracting a bigger value [need it in signed]
-	set_flag(FLAG_CARRY, (sTarget & 0xFF) < (sValue & 0xFF));
-
-	target = (Byte)(result & 0xFF);
-}
-
-void Emulator::SUB(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	SUB(target, value);
+	Byte result = (Byte)(target - value);
+	setLazyFlags(LAZY_SUB, target, value, 0, result);
+	target = result;
 }
 
 void Emulator::SBC(Byte& target, Byte value)
 {
-	Byte carry = (reg_AF.lo & 0x10) >> 4;
-	Word_Signed result = (Word_Signed)target - (Word_Signed)value - (Word_Signed)carry;
-	Byte_Signed sTarget = (Byte_Signed)target;
-	Byte_Signed sValue = (Byte_Signed)value;
-
-	set_flag(FLAG_ZERO, (result & 0xFF) == 0);
-	set_flag(FLAG_SUB, true);
-	set_flag(FLAG_HALF_CARRY, ((sTarget & 0xF) - (sValue & 0xF) - carry) < 0); //If it's less than 0 that means it went negative & needed to borrow 
-	set_flag(FLAG_CARRY, (target & 0xFF) < (value + carry)); //subtracting value is greater than the target
-
-	target = (Byte)(result & 0xFF);
-}
-
-void Emulator::SBC(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	SBC(target, value);
+	Byte carry = (flags() & 0x10) >> 4;
+	Byte result = (Byte)(target - value - carry);
+	setLazyFlags(LAZY_SBC, target, value, carry, result);
+	target = result;
 }
 
 void Emulator::AND(Byte& target, Byte value)
 {
 	target &= value;
-
-	set_flag(FLAG_ZERO, target == 0);
-	set_flag(FLAG_SUB, false);
-	set_flag(FLAG_CARRY, false);
-	set_flag(FLAG_HALF_CARRY, true);
-
-}
-
-void Emulator::AND(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	AND(target, value);
+	setLazyFlags(LAZY_AND, 0, 0, 0, target);
 }
 
 void Emulator::OR(Byte& target, Byte value)
 {
 	target |= value;
-
-	set_flag(FLAG_ZERO, target == 0);
-	set_flag(FLAG_SUB, false);
-	set_flag(FLAG_CARRY, false);
-	set_flag(FLAG_HALF_CARRY, false);
-}
-
-void Emulator::OR(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	OR(target, value);
+	setLazyFlags(LAZY_OR_XOR, 0, 0, 0, target);
 }
 
 void Emulator::XOR(Byte& target, Byte value)
 {
 	target ^= value;
-
-	set_flag(FLAG_ZERO, target == 0);
-	set_flag(FLAG_SUB, false);
-	set_flag(FLAG_CARRY, false);
-	set_flag(FLAG_HALF_CARRY, false);
-}
-
-void Emulator::XOR(Byte& target, Address addr)
-{
-	Byte value = readMemory(addr);
-	XOR(target, value);
+	setLazyFlags(LAZY_OR_XOR, 0, 0, 0, target);
 }
 
 void Emulator::CP(Byte& target, Byte value)
 {
-	set_flag(FLAG_ZERO, target == value);
-	set_flag(FLAG_SUB, true);
-	set_flag(FLAG_CARRY, ((target & 0xFF) < (value & 0xFF)));
-	set_flag(FLAG_HALF_CARRY, ((target & 0xF) < (value & 0xF)));
+	setLazyFlags(LAZY_SUB, target, value, 0, (Byte)(target - value)); //same flags as SUB, A is left alone
 }
 
-void Emulator::CP(Byte& target, Address addr)
+//the 8 alu operations on A in opcode order (the y field of 0x80-0xBF & 0xC6-0xFE)
+void Emulator::alu(int operation, Byte value)
 {
-	Byte value = readMemory(addr);
-	CP(target, value);
+	switch (operation)
+	{
+	case 0: ADD(reg_AF.hi, value); break;
+	case 1: ADC(reg_AF.hi, value); break;
+	case 2: SUB(reg_AF.hi, value); break;
+	case 3: SBC(reg_AF.hi, value); break;
+	case 4: AND(reg_AF.hi, value); break;
+	case 5: XOR(reg_AF.hi, value); break;
+	case 6: OR(reg_AF.hi, value); break;
+	case 7: CP(reg_AF.hi, value); break;
+	}
 }
 
 void Emulator::INC(Byte& target)
 {
 	Byte result = target + 1;
 
-	set_flag(FLAG_ZERO, result == 0);
-	set_flag(FLAG_SUB, false);
-	set_flag(FLAG_HALF_CARRY, ((target & 0xf) + (0x1)) & 0x10);
+	flags(); //carry is kept so whatever was pending has to be applied first
+	setLazyFlags(LAZY_INC, target, 1, 0, result);
 
 	target = result;
-
-}
-
-//INC (HL)
-void Emulator::INC(Address addr)
-{
-	Byte value = readMemory(addr);
-	INC(value);
-	writeMemory(addr, value);
 }
 
 void Emulator::DEC(Byte& target)
 {
-	Byte_Signed sTarget = (Byte_Signed)target;
+	Byte result = target - 1;
 
-	target -= 1;
+	flags(); //carry is kept so whatever was pending has to be applied first
+	setLazyFlags(LAZY_DEC, target, 1, 0, result);
 
-	set_flag(FLAG_ZERO, target == 0);
-	set_flag(FLAG_SUB, true);
-	set_flag(FLAG_HALF_CARRY, (sTarget & 0xF) - 1 < 0);
-}
-
-void Emulator::DEC(Address addr)
-{
-	Byte value = readMemory(addr);
-	DEC(value);
-	writeMemory(addr, value);
+	target = result;
 }
 
 // 16-bit arithmetic
@@ -353,13 +419,6 @@ void Emulator::SL(Byte& target)
 	target <<= 1;
 }
 
-void Emulator::SL(Address addr)
-{
-	Byte value = readMemory(addr);
-	SL(value);
-	writeMemory(addr, value);
-}
-
 // Shift Right
 void Emulator::SR(Byte& target, bool include_top_bit)
 {
@@ -380,20 +439,13 @@ void Emulator::SR(Byte& target, bool include_top_bit)
 
 }
 
-void Emulator::SR(Address addr, bool include_top_bit)
-{
-	Byte value = readMemory(addr);
-	SR(value, include_top_bit);
-	writeMemory(addr, value);
-}
-
 // Shifts through carry
 void Emulator::RL(Byte& target, bool carry, bool zero_flag)
 {
 	int bit7 = ((target & 0x80) != 0);
 	target = target << 1;
 
-	target |= (carry) ? ((reg_AF.lo & FLAG_CARRY) != 0) : bit7;
+	target |= (carry) ? ((flags() & FLAG_CARRY) != 0) : bit7;
 
 	set_flag(FLAG_ZERO, ((zero_flag) ? (target == 0) : false));
 	set_flag(FLAG_SUB, false);
@@ -402,19 +454,12 @@ void Emulator::RL(Byte& target, bool carry, bool zero_flag)
 
 }
 
-void Emulator::RL(Address addr, bool carry)
-{
-	Byte value = readMemory(addr);
-	RL(value, carry, true);
-	writeMemory(addr, value);
-}
-
 void Emulator::RR(Byte& target, bool carry, bool zero_flag)
 {
 	int bit1 = ((target & 0x1) != 0);
 	target = target >> 1;
 
-	target |= (carry) ? (((reg_AF.lo & FLAG_CARRY) != 0) << 7) : (bit1 << 7);
+	target |= (carry) ? (((flags() & FLAG_CARRY) != 0) << 7) : (bit1 << 7);
 
 	set_flag(FLAG_ZERO, ((zero_flag) ? (target == 0) : false));
 	set_flag(FLAG_SUB, false);
@@ -422,16 +467,6 @@ void Emulator::RR(Byte& target, bool carry, bool zero_flag)
 	set_flag(FLAG_CARRY, (bit1 != 0));
 }
 
-//RR[HL]
-void Emulator::RR(Address addr, bool carry)
-{
-	Byte value = readMemory(addr);
-	RR(value, carry, true);
-	writeMemory(addr, value);
-
-	return;
-}
-
 void Emulator::SRA(Byte& target)
 {
 	// content of bit 7 is unchanged
@@ -441,26 +476,12 @@ void Emulator::SRA(Byte& target)
 	set_flag(FLAG_ZERO, (target == 0));
 }
 
-void Emulator::SRA(Address addr)
-{
-	Byte value = readMemory(addr);
-	SRA(value);
-	writeMemory(addr, value);
-}
-
 //?same as shift right but bit 7 is reset
 void Emulator::SRL(Byte& target)
 {
 	RR(target, true, true);
 }
 
-void Emulator::SRL(Address addr)
-{
-	Byte value = readMemory(addr);
-	SRL(value);
-	writeMemory(addr, value);
-}
-
 void Emulator::SWAP(Byte& target)
 {
 	Byte low = lowNibble(target);
@@ -474,13 +495,6 @@ void Emulator::SWAP(Byte& target)
 	set_flag(FLAG_ZERO, (target == 0));
 }
 
-void Emulator::SWAP(Address addr)
-{
-	Byte value = readMemory(addr);
-	SWAP(value);
-	writeMemory(addr, value);
-}
-
 // Bit operations
 void Emulator::BIT(Byte target, int bit)
 {
@@ -492,25 +506,12 @@ void Emulator::BIT(Byte target, int bit)
 	set_flag(FLAG_ZERO, set);
 }
 
-void Emulator::BIT(Address addr, int bit)
-{
-	Byte value = readMemory(addr);
-	BIT(value, bit);
-}
-
 void Emulator::SET(Byte& target, int bit)
 {
 	Byte bBit = (Byte)bit;
 	target |= (1 << bBit);
 }
 
-void Emulator::SET(Address addr, int bit)
-{
-	Byte value = readMemory(addr);
-	SET(value, bit);
-	writeMemory(addr, value);
-}
-
 void Emulator::RES(Byte& target, int bit)
 {
 	Byte bBit = (Byte)bit;
@@ -519,13 +520,6 @@ void Emulator::RES(Byte& target, int bit)
 
 }
 
-void Emulator::RES(Address addr, int bit)
-{
-	Byte value = readMemory(addr);
-	RES(value, bit);
-	writeMemory(addr, value);
-}
-
 void Emulator::SCF()
 {
 	set_flag(FLAG_CARRY, true);
@@ -535,47 +529,34 @@ void Emulator::SCF()
 
 void Emulator::CCF()
 {
-	bool set = testBit(reg_AF.lo, BIT_4);
+	bool set = testBit(flags(), BIT_4);
 
 	set_flag(FLAG_CARRY, !set);
 	set_flag(FLAG_HALF_CARRY, false);
 	set_flag(FLAG_SUB, false);
 }
 
-// Jump instructions
-
-void Emulator::JP(Register target)
+/*Conditions from the cc field of the jump, call & return opcodes: NZ Z NC C. The non conditional 
+versions of those instructions are below, conditional ones only call them when this is true.*/
+bool Emulator::condition(int cc)
 {
-	reg_PC = target.reg;
-	op(0, 1);  //shouldn't it be 3?
-}
+	Byte f = flags();
 
-void Emulator::JPNZ(Register target)
-{
-	bool set = (reg_AF.lo >> 7) & 1 ? true : false;
-	if (!set) //jump if 'zero' flag = 0
-		JP(target);
-}
-
-void Emulator::JPZ(Register target)
-{
-	bool set = (reg_AF.lo >> 7) & 1 ? true : false; 
-	if (set) //jump if 'zero' flag = 1
-		JP(target);
+	switch (cc)
+	{
+	case 0: return !testBit(f, BIT_7);
+	case 1: return testBit(f, BIT_7);
+	case 2: return !testBit(f, BIT_4);
+	default: return testBit(f, BIT_4);
+	}
 }
 
-void Emulator::JPNC(Register target)
-{
-	bool set = (reg_AF.lo >> 4) & 1 ? true : false; 
-	if (!set) //jump if carry flag = 0
-		JP(target);
-}
+// Jump instructions
 
-void Emulator::JPC(Register target)
+void Emulator::JP(Register target)
 {
-	bool set = (reg_AF.lo >> 4) & 1 ? true : false; 
-	if (set) //jump if carry flag = 1
-		JP(target);
+	reg_PC = target.reg;
+	op(0, 1);  //shouldn't it be 3?
 }
 
 void Emulator::JR(Byte value)
@@ -585,50 +566,24 @@ void Emulator::JR(Byte value)
 	op(0, 1); //shouldn't it be 2?
 }
 
-void Emulator::JRNZ(Byte value)
-{
-	bool set = (reg_AF.lo >> 7) & 1 ? true : false; 
-	if (!set) //jump if 'zero' flag = 0
-		JR(value);
-}
-
-
-void Emulator::JRZ(Byte value)
-{
-	bool set = (reg_AF.lo >> 7) & 1 ? true : false; 
-	if (set) //jump if 'zero' flag = 1
-		JR(value);
-}
-
-void Emulator::JRNC(Byte value)
-{
-	bool set = (reg_AF.lo >> 4) & 1 ? true : false; 
-	if (!set) //jump if carry flag = 0
-		JR(value);
-}
-
-
-void Emulator::JRC(Byte value)
-{
-	bool set = (reg_AF.lo >> 4) & 1 ? true : false; 
-	if (set) //jump if carry flag = 1
-		JR(value);
-}
-
 void Emulator::JPHL()
 {
 	reg_PC = reg_HL.reg; 
 }
 
 // Function Instructions
+template <class Timing>
 void Emulator::CALL(Byte low, Byte high)
 {
 	Byte lPC = lowByte(reg_PC);
 	Byte hPC = highByte(reg_PC);
 
+	Timing::machineCycle(*this); //SP gets decremented first
 	reg_SP--;
+	Timing::machineCycle(*this);
 	writeMemory(reg_SP, hPC);
 	reg_SP--;
+	Timing::machineCycle(*this);
 	writeMemory(reg_SP, lPC);
 
 	Register temp;
@@ -638,37 +593,12 @@ void Emulator::CALL(Byte low, Byte high)
 	op(0, 2); //Because JP is called (which is 1 cycle), need to have op(0,2) so it'll equal to a total of op(0,3)
 }
 
-void Emulator::CALLNZ(Byte low, Byte high)
-{
-	bool set = testBit(reg_AF.lo, BIT_7);
-	if (!set) //jump if 'zero' flag = 0
-		CALL(low, high);
-}
-
-void Emulator::CALLZ(Byte low, Byte high)
-{
-	bool set = testBit(reg_AF.lo, BIT_7);
-	if (set) //jump if 'zero' flag = 1
-		CALL(low, high);
-}
-
-void Emulator::CALLNC(Byte low, Byte high)
-{
-	bool set = testBit(reg_AF.lo, BIT_4);
-	if (!set) //jump if carry flag = 0
-		CALL(low, high);
-}
-
-void Emulator::CALLC(Byte low, Byte high)
-{
-	bool set = testBit(reg_AF.lo, BIT_4);
-	if (set) //jump if carry flag = 1
-		CALL(low, high);
-}
-
+template <class Timing>
 void Emulator::RET()
 {
+	Timing::machineCycle(*this);
 	Byte lAddr = readMemory(reg_SP++);
+	Timing::machineCycle(*this);
 	Byte hAddr = readMemory(reg_SP++);
 
 	reg_PC = (Word)(hAddr << 8) | lAddr;
@@ -676,58 +606,26 @@ void Emulator::RET()
 	op(0, 3); //shouldn't it be 2?
 }
 
+template <class Timing>
 void Emulator::RETI()
 {
 	interruptMasterEnable = true; //restore interrupts
-	RET();
-}
-
-void Emulator::RETNZ()
-{
-	bool set = testBit(reg_AF.lo, BIT_7);
-	if (!set) {//jump if 'zero' flag = 0
-		RET();
-		op(0, 2);
-	}
-}
-
-void Emulator::RETZ()
-{
-	bool set = testBit(reg_AF.lo, BIT_7);
-	if (set) { //jump if 'zero' flag = 1
-		RET();
-		op(0, 2);
-	}
-
-}
-
-void Emulator::RETNC()
-{
-	bool set = testBit(reg_AF.lo, BIT_4);
-	if (!set) {//jump if carry flag = 0
-		RET();
-		op(0, 2);
-	}
-}
-
-void Emulator::RETC()
-{
-	bool set = testBit(reg_AF.lo, BIT_4);
-	if (set) {//jump if carry flag = 1
-		RET();
-		op(0, 2);
-	}
+	RET<Timing>();
 }
 
 // Miscellaneous Instructions
+template <class Timing>
 void Emulator::RST(Address addr)
 {
 	Byte lPC = lowByte(reg_PC);
 	Byte hPC = highByte(reg_PC);
 
+	Timing::machineCycle(*this); //SP gets decremented first
 	reg_SP--;
+	Timing::machineCycle(*this);
 	writeMemory(reg_SP, hPC);
 	reg_SP--;
+	Timing::machineCycle(*this);
 	writeMemory(reg_SP, lPC);
 
 
@@ -735,37 +633,31 @@ void Emulator::RST(Address addr)
 
 }
 
-//https://ehaskins.com/2018-01-30%20Z80%20DAA/ --> explains DAA instruction
-void Emulator::DAA()
-{
-	Byte high = highNibble(reg_AF.hi);
-	Byte low = lowNibble(reg_AF.hi);
-
-	bool add = !(testBit(reg_AF.lo, BIT_6)); //check if the previous operation was a subtract (0 means it was an add)
-	bool carry = testBit(reg_AF.lo, BIT_4);
-	bool half_carry = testBit(reg_AF.lo, BIT_5);
-
-	Word result = (Word)reg_AF.hi;
-	Word correction = (carry) ? 0x60 : 0x00; //if there was a carry need to add 60 (or 6 to the second digit)
+//the handlers in opcode.cpp are instantiated for both (see CpuTiming.h)
+#define INSTANTIATE_MEMORY_INSTRUCTIONS(Timing) \
+	template void Emulator::LD<Timing>(Byte & destination, Address addr); \
+	template void Emulator::LD<Timing>(Address addr, Byte value); \
+	template void Emulator::LDNN<Timing>(Byte low, Byte high); \
+	template void Emulator::PUSH<Timing>(Byte high, Byte low); \
+	template void Emulator::POP<Timing>(Byte & high, Byte & low); \
+	template void Emulator::CALL<Timing>(Byte low, Byte high); \
+	template void Emulator::RET<Timing>(); \
+	template void Emulator::RETI<Timing>(); \
+	template void Emulator::RST<Timing>(Address addr);
 
-	if (half_carry || (add) && ((result & 0x0F) > 9))
-		correction |= 0x06; //there was half carry or the value is greater than 9
+INSTANTIATE_MEMORY_INSTRUCTIONS(InstructionTiming)
+INSTANTIATE_MEMORY_INSTRUCTIONS(MCycleTiming)
 
-	if (carry || (add) && (result > 0x99))
-		correction |= 0x60;
+#undef INSTANTIATE_MEMORY_INSTRUCTIONS
 
-	if (add)
-		result += correction; //for adding need to add correction
-	else
-		result -= correction; //o/w subtract
-
-	if (((correction << 2) & 0x100) != 0) //check if there was a carry and is greather than 0x99
-		set_flag(FLAG_CARRY, true);
-
-	set_flag(FLAG_HALF_CARRY, false);
-	reg_AF.hi = (Byte)(result & 0xFF);
-	set_flag(FLAG_ZERO, reg_AF.hi == 0);
+//N H C & A pick the corrected A & the new flags out of s_daaTable
+void Emulator::DAA()
+{
+	Byte f = flags();
+	Word entry = s_daaTable[((f & (FLAG_SUB | FLAG_HALF_CARRY | FLAG_CARRY)) << 4) | reg_AF.hi];
 
+	reg_AF.hi = highByte(entry);
+	reg_AF.lo = (f & 0x0F) | lowByte(entry);
 }
 
 void Emulator::CPL()
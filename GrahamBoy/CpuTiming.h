@@ -0,0 +1,33 @@
+#pragma once
+#include "types.h"
+
+class Emulator;
+
+//when the rest of the hardware sees the cpu's memory accesses, picked before run like the ppu tier
+enum CpuTiming
+{
+	CPU_TIMING_INSTRUCTION,
+	CPU_TIMING_MCYCLE //always interpreted, see MCycleTiming
+};
+
+/*The run loop & the interpreter's handlers are templates over one of these as well, the handlers call machineCycle
+before every memory access after the opcode fetch & for the internal cycles that come before one (PUSH, CALL, RST
+& a taken RET cc).
+
+InstructionTiming is the regular core: the timers & lcd get handed the whole instruction's cycles once it's done
+(see op & catchUp), machineCycle is empty & inlined away.*/
+struct InstructionTiming
+{
+	static const bool PER_ACCESS = false;
+	static void machineCycle(Emulator & emu) {}
+};
+
+/*Hands the timers & lcd each machine cycle (4 clock cycles) as it goes by, so an access sees LY, STAT, DIV, TIMA &
+the interrupt flags as they are at that point of the instruction instead of how they were before it started.
+catchUp only gets what's left over once the instruction's done. Runs on the interpreter whatever the cpu engine,
+idle & copy loops don't get skipped.*/
+struct MCycleTiming
+{
+	static const bool PER_ACCESS = true;
+	static void machineCycle(Emulator & emu);
+};
@@ -0,0 +1,126 @@
+#include "Display.h"
+#include "Emulator.h"
+#include "FrameTrace.h"
+#include <stdlib.h>
+
+Display::Display(uint32_t * bgData, uint32_t * windowData, uint32_t * spriteData)
+{
+	int scale = 5;
+
+	this->bgData = bgData;
+	this->windowData = windowData;
+	this->spriteData = spriteData;
+
+	if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		exit(-1);
+
+	window = SDL_CreateWindow("Gameboy Emulator", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width * scale, height * scale, SDL_WINDOW_SHOWN);
+	if (window == NULL)
+		exit(-1);
+
+	//need to use surfaces b/c overlapping background/sprites/window together which apparently can't be done on textures
+	bgSurf = SDL_CreateRGBSurfaceFrom((void*)bgData, 160, 144, 32, 160 * sizeof(int), 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+	windowSurf = SDL_CreateRGBSurfaceFrom((void*)windowData, 160, 144, 32, 160 * sizeof(int), 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+	spriteSurf = SDL_CreateRGBSurfaceFrom((void*)spriteData, 160, 144, 32, 160 * sizeof(int), 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+	SDL_SetColorKey(spriteSurf, SDL_TRUE, SDL_MapRGB(spriteSurf->format, 255, 255, 255)); //sets the color key (transparent pixel) in a surface!
+	screenSurface = SDL_GetWindowSurface(window);
+
+	rec.w = width * scale; rec.h = height * scale; rec.x = 0; rec.y = 0;
+}
+
+Display::~Display()
+{
+	SDL_FreeSurface(bgSurf);
+	SDL_FreeSurface(spriteSurf);
+	SDL_FreeSurface(windowSurf);
+	SDL_FreeSurface(screenSurface);
+}
+
+//Need tot lock the surfaces and update the pixels individually
+void Display::copyLayer(SDL_Surface * surface, const uint32_t * data)
+{
+	SDL_LockSurface(surface);
+	int * pixels = (int *)surface->pixels;
+	for (int i = 0; i < 160; i++)
+	{
+		for (int j = 0; j < 144; j++)
+		{
+			if (pixels[j * surface->w + i] != (int)data[i + j * width])
+				pixels[j * surface->w + i] = data[i + j * width];
+		}
+	}
+	SDL_UnlockSurface(surface);
+}
+
+void Display::present()
+{
+	copyLayer(bgSurf, bgData);
+	copyLayer(spriteSurf, spriteData);
+	copyLayer(windowSurf, windowData);
+
+	ScopedPhase present("present");
+
+	//Apply the image --> blit onto the screenSurface
+	SDL_BlitScaled(bgSurf, NULL, screenSurface, &rec);
+	SDL_BlitScaled(spriteSurf, NULL, screenSurface, &rec);
+	SDL_BlitScaled(windowSurf, NULL, screenSurface, &rec);
+
+	//Update the surface
+	SDL_UpdateWindowSurface(window);
+}
+
+void Display::setTitle(const char * title)
+{
+	SDL_SetWindowTitle(window, title);
+}
+
+bool Display::handleEvents(Emulator & emu)
+{
+	bool open = true;
+
+	while (SDL_PollEvent(&e) != 0)
+	{
+		if (e.type == SDL_QUIT)
+		{
+			open = false;
+			continue;
+		}
+
+		if (e.type != SDL_KEYDOWN && e.type != SDL_KEYUP)
+			continue;
+
+		if (e.type == SDL_KEYDOWN && e.key.repeat != 0)
+			continue;
+
+		if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F1) //frame stats overlay
+		{
+			emu.showFrameStats = !emu.showFrameStats;
+			if (!emu.showFrameStats)
+				setTitle("Gameboy Emulator");
+			continue;
+		}
+
+		//the bit of the joypad register each key is, the d-pad & the buttons are read separately
+		int key;
+		bool directional = true;
+		switch (e.key.keysym.sym)
+		{
+			case SDLK_UP: key = BIT_2; break;
+			case SDLK_DOWN: key = BIT_3; break;
+			case SDLK_LEFT: key = BIT_1; break;
+			case SDLK_RIGHT: key = BIT_0; break;
+			case SDLK_SPACE: key = BIT_0; directional = false; break; //A
+			case SDLK_LCTRL: key = BIT_1; directional = false; break; //B
+			case SDLK_RETURN: key = BIT_2; directional = false; break; //Enter
+			case SDLK_RSHIFT: key = BIT_3; directional = false; break; //Select
+			default: continue; //not one of the buttons -> do nothing
+		}
+
+		if (e.type == SDL_KEYDOWN)
+			emu.keyPressed(key, directional);
+		else
+			emu.keyReleased(key, directional);
+	}
+
+	return open;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <SDL.h>
+#include "types.h"
+
+class Emulator;
+
+/*The window the frames get shown in & the keyboard, everything that needs SDL. The emulator only makes one when
+it isn't headless & keeps nothing of it but the pointer, the emulator itself is just the gameboy. The surfaces
+are made straight from the emulator's background, window & sprite buffers.*/
+class Display
+{
+public:
+	Display(uint32_t * bgData, uint32_t * windowData, uint32_t * spriteData);
+	~Display();
+
+	//blits the three layers into the window
+	void present();
+	void setTitle(const char * title);
+
+	//hands the key presses & releases to emu, returns false once the window has been closed
+	bool handleEvents(Emulator & emu);
+
+private:
+	uint32_t * bgData;
+	uint32_t * windowData;
+	uint32_t * spriteData;
+
+	SDL_Rect rec;
+	SDL_Surface * bgSurf;
+	SDL_Surface * windowSurf;
+	SDL_Surface * spriteSurf;
+
+	SDL_Window * window;
+	SDL_Surface * screenSurface;
+	SDL_Event e;
+
+	static void copyLayer(SDL_Surface * surface, const uint32_t * data);
+};
@@ -1,18 +1,36 @@
 #include "Emulator.h"
 #include "types.h"
+#include "FrameTrace.h"
+#include "BlockCache.h"
+#include "Jit.h"
+#include "Display.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
-#include <SDL.h>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
 
-//#define OPCODES
-Emulator::Emulator()
+Emulator::Emulator(bool headless)
 {
-	memset(cartridgeMemory, 0, sizeof(cartridgeMemory));
+	cartridgeMemory.assign(0x200000, 0);
+	memset(memory, 0, sizeof(memory));
 	memset(&ramBank, 0, sizeof(ramBank));
 	quit = false;
+	this->headless = headless;
+	blockCache = NULL;
+	jit = NULL;
+	translationCache = false;
+	aotLibrary = NULL;
+	showFrameStats = false;
+	ppuTier = PPU_SCANLINE;
+	cpuTiming = CPU_TIMING_INSTRUCTION;
+	handedOverCycles = 0;
 
 	reg_AF.reg = 0x01B0;
+	lazyOp = FLAGS_READY;
 	reg_BC.reg = 0x0013;
 	reg_DE.reg = 0x00D8;
 	reg_HL.reg = 0x014D;
@@ -56,12 +74,20 @@ Emulator::Emulator()
 	romBanking = true; //defaults to true
 	interruptMasterEnable = true;
 	halted = false;
+	updateInterruptPending();
 
 	
+	currentRomBank = 1;
 	currentRamBank = 0; //values are from 0-3 --> 4 ram banks
 	//RAM Banking is not used in MBC2! Therefore m_CurrentRAMBank will always be 0!
+	mapReadPages();
 
 	num_cycles = 0;
+	totalCycles = 0;
+	nextTimerEvent = 0;
+	dmaEndsAt = 0;
+	graphicsSlack = -1;
+	graphicsPending = 0;
 
 	// Initialize input to HIGH state (unpressed)
 	joypadButtons = 0xF;
@@ -70,11 +96,45 @@ Emulator::Emulator()
 	initDisplay();
 }
 
-void Emulator::loadRom(char * location)
+Emulator::~Emulator()
+{
+	saveTranslationCache();
+	delete blockCache;
+	delete jit;
+	delete display;
+	unloadAotModule();
+}
+
+void * Emulator::operator new(size_t size)
+{
+	void * object;
+#ifdef _WIN32
+	object = _aligned_malloc(size, alignof(Emulator));
+#else
+	if (posix_memalign(&object, alignof(Emulator), size) != 0)
+		object = NULL;
+#endif
+	if (object == NULL)
+		throw std::bad_alloc();
+	return object;
+}
+
+void Emulator::operator delete(void * object)
+{
+#ifdef _WIN32
+	_aligned_free(object);
+#else
+	free(object);
+#endif
+}
+
+bool Emulator::loadRom(const char * location)
 {
 	FILE *in;
-	fopen_s(&in, location, "rb");
-	fread(cartridgeMemory, 1, 0x200000, in);
+	if (fopen_s(&in, location, "rb") != 0 || in == NULL)
+		return false;
+
+	fread(&cartridgeMemory[0], 1, 0x200000, in);
 	fclose(in);
 
 	/* To detect what ROM mode the game is you have to read memory 0x147 after the game has been loaded into memory. 
@@ -90,9 +150,14 @@ void Emulator::loadRom(char * location)
 	
 	memcpy(&memory[0], &cartridgeMemory[0], 0x8000);
 	currentRomBank = 1;
+	mapReadPages();
+	loadAotModule();
+	loadTranslationCache(location);
+	return true;
 }
 
-void Emulator::run()
+template <class Ppu, class Timing, class Profiler>
+void Emulator::runLoop(Profiler & profiler)
 {
 	/* According to game pan docs site the amount of clock cycles the gameboy can exectue every second 
 	is 4194304 which means that if each frame we update the emulator 60 times a second the each frame 
@@ -101,85 +166,330 @@ void Emulator::run()
 	*/
 	int cyclesThisUpdate = 0;
 
-#ifdef OPCODES
-	FILE *fp;
-	fopen_s(&fp, "C:/Users/lemar/Desktop/Home/New folder/C++/gramma.txt", "w+");
-#endif
-
 	while (!quit)
 	{
-		handleEvents();
+		ScopedPhase frame("frame");
 
-		while (cyclesThisUpdate <= MAXCYCLES)
 		{
-			
-			/*#ifdef TEST
-			fprintf(fp, "PC: %4X\n", reg_PC);
-			#endif*/
-
-#ifdef OPCODES
-			Byte code = readMemory(reg_PC); 
-			Address addr = reg_PC;
-			addr++;
-			Opcode temp = readMemory(addr);
-			if (code == 0xCB)
-			{
-				
-				fprintf(fp, "%04X: " //X means uppercase hex
-					"A:%02x "
-					"B:%02x "
-					"C:%02x "
-					"D:%02x "
-					"E:%02x "
-					"F:%02x "
-					"H:%02x "
-					"L:%02x "
-					"SP:%04x "
-					"Opcode:CB %02x "
-					"Memory: %02X\n",
-					reg_PC, reg_AF.hi, reg_BC.hi, reg_BC.lo, reg_DE.hi, reg_DE.lo, reg_AF.lo, reg_HL.hi, reg_HL.lo, reg_SP, temp, readMemory(0xdffb));
-			}
-			else 
-				fprintf(fp, "%04X: " //X means uppercase hex
-					"A:%02x "
-					"B:%02x "
-					"C:%02x "
-					"D:%02x "
-					"E:%02x "
-					"F:%02x "
-					"H:%02x "
-					"L:%02x "
-					"SP:%04x "
-					"Opcode:%02x "
-					"Memory: %02X\n",
-					reg_PC, reg_AF.hi, reg_BC.hi, reg_BC.lo, reg_DE.hi, reg_DE.lo, reg_AF.lo, reg_HL.hi, reg_HL.lo, reg_SP, code, readMemory(0xdffb));
-			
-#endif // DEBUG
-			executeNextOpcode();
-			cyclesThisUpdate += num_cycles;
-			
-			/*timers and graphics are being passed how many clock cycles 
-			the opcode took so they can update at the same rate as the cpu*/
-			handleInterrupts();
-
-			updateTimers(num_cycles); 
-			updateGraphics(num_cycles);
-
-			
-
-			num_cycles = 0;
+			ScopedPhase phase("handleEvents");
+			if (display && !display->handleEvents(*this))
+				quit = true;
+		}
 
+		{
+			//drawScanLine & renderScreen get timed as phases nested inside this one
+			ScopedPhase phase("cpu");
+			while (cyclesThisUpdate <= MAXCYCLES)
+				cyclesThisUpdate += advance<Ppu, Timing>(profiler, MAXCYCLES - cyclesThisUpdate);
+			drawPendingLines();
 		}
 
 		cyclesThisUpdate = 0;
 
+		//makes the frames that went over the 16.7ms budget easy to search for in the trace
+		if (frame.elapsed() > FRAME_BUDGET_NS)
+			frame.rename("frame (over budget)");
 	}
 
-	#ifdef TEST
-		fclose(fp);
-	#endif
+	delete display; //closes the window
+	display = NULL;
+}
 
-	destroySDL();
+//executes a single instruction & lets the rest of the hardware catch up, returns the clock cycles it took
+template <class Ppu, class Timing, class Profiler>
+int Emulator::step(Profiler & profiler)
+{
+	profiler.beginInstruction(*this);
+	if (Timing::PER_ACCESS)
+		executeMCycleOpcode();
+	else if (blockCache)
+		executeCachedOpcode();
+	else
+		executeNextOpcode();
+	int cycles = num_cycles;
+	profiler.endInstruction(cycles);
+
+	if (Timing::PER_ACCESS)
+	{
+		//only what's left after the instruction's last memory access
+		num_cycles -= handedOverCycles;
+		handedOverCycles = 0;
+		catchUp<Ppu>(num_cycles);
+	}
+	else
+		catchUp<Ppu>(cycles);
+
+	if (Ppu::SKIPS_AHEAD && !Timing::PER_ACCESS)
+	{
+		idleLoop.instructionDone(*this, cycles);
+		copyLoop.instructionDone(*this, cycles);
+	}
+	return cycles;
+}
+
+//the lcd only gets stepped once it's about to do something (see graphicsSlack)
+void ScanlinePpu::step(Emulator & emu, int cycles)
+{
+	if (cycles <= emu.graphicsSlack)
+	{
+		emu.graphicsSlack -= cycles;
+		emu.graphicsPending += cycles;
+	}
+	else
+		emu.updateGraphics(cycles);
+}
+
+void PixelFifoPpu::step(Emulator & emu, int cycles)
+{
+	emu.pixelFifo.step(emu, cycles);
+}
+
+/*The interpreter's handlers are the only thing instantiated on MCycleTiming, so rather than a set of them per ppu 
+tier this picks the tier for every machine cycle. Interrupts still only get serviced between instructions.*/
+void MCycleTiming::machineCycle(Emulator & emu)
+{
+	emu.handedOverCycles += 4;
+
+	if (emu.totalCycles + 4 >= emu.nextTimerEvent)
+		emu.updateTimers(4);
+
+	if (emu.ppuTier == PPU_PIXEL_FIFO)
+		PixelFifoPpu::step(emu, 4);
+	else
+		ScanlinePpu::step(emu, 4);
+
+	emu.totalCycles += 4;
+}
+
+/*timers and graphics are being passed how many clock cycles 
+the opcode took so they can update at the same rate as the cpu*/
+template <class Ppu>
+void Emulator::catchUp(int cycles)
+{
+	if (interruptPending)
+		handleInterrupts();
+
+	//the divider & timer only get stepped when one of them is due (see nextTimerEvent)
+	if (totalCycles + num_cycles >= nextTimerEvent)
+		updateTimers(num_cycles);
+
+	Ppu::step(*this, num_cycles);
+
+	totalCycles += cycles;
+	num_cycles = 0;
+}
+
+//compiled blocks & skipped idle loops hand their cycles over through this one (see Jit.cpp & IdleLoop.cpp)
+template void Emulator::catchUp<ScanlinePpu>(int cycles);
+
+/*How many of the next clock cycles the timers & graphics can be given in one go (see fastForward) with the same 
+result as being given them an instruction at a time, at most limit. That's the case while none of them reaches a 
+point where it does something: the divider or timer ticking, the scanline ending or the lcd moving into its next 
+mode. setLCDStatus also has to have seen the same line & mode when the last instruction's cycles got handed over 
+so it doesn't change STAT or request an interrupt, & there can't be an interrupt waiting to be serviced.*/
+int Emulator::quietCycles(int limit, int lastCycles)
+{
+	if ((memory[0xFF0F] & memory[0xFFFF] & 0x1F) != 0)
+		return 0;
+
+	//what the cpu reads changes once an oam dma is over & copy loops write memory behind the bus' back
+	if (totalCycles < dmaEndsAt)
+		return 0;
+
+	syncTimers();
+	if (255 - dividerCounter < limit)
+		limit = 255 - dividerCounter;
+	if (isClockEnabled() && timerCounter - 1 < limit)
+		limit = timerCounter - 1;
+
+	syncGraphics();
+	if (isLCDEnabled())
+	{
+		//updateGraphics resets the counter to 456 when a scanline ends, so anything higher means it just did
+		int band = lcdBand(scanlineCounter);
+		if (scanlineCounter + lastCycles > 456 || lcdBand(scanlineCounter + lastCycles) != band)
+			return 0;
+
+		int lowest = lcdBandEnd(band);
+		if (scanlineCounter - lowest < limit)
+			limit = scanlineCounter - lowest;
+	}
+
+	return (limit > 0) ? limit : 0;
+}
+
+//cycles that quietCycles said can go in one go, the instructions that took them have already been run
+void Emulator::fastForward(int cycles)
+{
+	updateTimers(cycles);
+	updateGraphics(cycles);
+	totalCycles += cycles;
+}
+
+/*One trip round the run loop: skipping an idle loop, a whole compiled block when running on CPU_JIT (both stop 
+once they've gone past budget cycles, same as the loop would), a run of copy loop iterations or a single instruction 
+otherwise. Profilers & tracers need to see every instruction so they always step, so does the pixel fifo (see Ppu.h).*/
+template <class Ppu, class Timing, class Profiler>
+int Emulator::advance(Profiler & profiler, int budget)
+{
+	return step<Ppu, Timing>(profiler);
+}
+
+template <class Ppu, class Timing>
+int Emulator::advance(NullProfiler & profiler, int budget)
+{
+	if (!Ppu::SKIPS_AHEAD || Timing::PER_ACCESS)
+		return step<Ppu, Timing>(profiler);
+
+	if (idleLoop.found())
+	{
+		int cycles = idleLoop.skip(*this, budget);
+		if (blockCache)
+			blockCache->leaveBlock(); //none of the skipped instructions went through it
+		return cycles;
+	}
+
+	if (copyLoop.found())
+	{
+		int cycles = copyLoop.run(*this, budget);
+		if (cycles > 0)
+			return cycles;
+	}
+
+	return jit ? runNative(budget) : step<Ppu, Timing>(profiler);
+}
+
+/*Runs the compiled block at the PC if there is one, otherwise a single instruction. The loop detectors only get 
+told about the last instruction a block ran, so blocks are left alone while either of them is looking at a loop.*/
+int Emulator::runNative(int budget)
+{
+	int entry = 0;
+	JitFunction block = (idleLoop.watching() && copyLoop.watching()) ? blockCache->native(*this, *jit, entry) : NULL;
+	if (block != NULL)
+	{
+		flags(); //compiled code keeps F worked out
+		nativeStart = totalCycles;
+		nativeBudget = budget;
+		nativeKey = ~0u;
+		nativeLast = -1;
+		block(this, nativeQuiet(), entry);
+		blockCache->leaveNative(*this);
+
+		//otherwise the hardware wasn't quiet for long enough to run even the first instruction
+		if (nativeLast >= 0)
+		{
+			Address last = (Address)nativeLast;
+			int lastCycles = nativeLast >> 16;
+			idleLoop.resume(last);
+			idleLoop.instructionDone(*this, lastCycles);
+			copyLoop.resume(last);
+			copyLoop.instructionDone(*this, lastCycles);
+			return (int)(totalCycles - nativeStart);
+		}
+	}
+
+	NullProfiler profiler;
+	return step<ScanlinePpu, InstructionTiming>(profiler);
+}
+
+//one frame's worth of cycles without any window/input handling
+template <class Ppu, class Timing, class Profiler>
+int Emulator::runFrame(Profiler & profiler)
+{
+	int cyclesThisUpdate = 0;
+	while (cyclesThisUpdate <= MAXCYCLES)
+		cyclesThisUpdate += advance<Ppu, Timing>(profiler, MAXCYCLES - cyclesThisUpdate);
+	drawPendingLines();
+
+	return cyclesThisUpdate;
+}
+
+void Emulator::run()
+{
+	NullProfiler profiler;
+	runFrames(profiler, 0);
+	frameStats.report(stdout);
+}
+
+/*Runs maxFrames frames headless, or until the window is closed when maxFrames <= 0, on the run loop instantiated 
+for the ppu tier & cpu timing that were picked*/
+template <class Profiler>
+void Emulator::runFrames(Profiler & profiler, int maxFrames)
+{
+	if (ppuTier == PPU_PIXEL_FIFO)
+	{
+		if (cpuTiming == CPU_TIMING_MCYCLE)
+			runFrames<PixelFifoPpu, MCycleTiming>(profiler, maxFrames);
+		else
+			runFrames<PixelFifoPpu, InstructionTiming>(profiler, maxFrames);
+	}
+	else
+	{
+		if (cpuTiming == CPU_TIMING_MCYCLE)
+			runFrames<ScanlinePpu, MCycleTiming>(profiler, maxFrames);
+		else
+			runFrames<ScanlinePpu, InstructionTiming>(profiler, maxFrames);
+	}
+}
+
+template <class Ppu, class Timing, class Profiler>
+void Emulator::runFrames(Profiler & profiler, int maxFrames)
+{
+	if (maxFrames <= 0)
+	{
+		runLoop<Ppu, Timing>(profiler);
+		return;
+	}
+
+	for (int frame = 0; frame < maxFrames; frame++)
+		runFrame<Ppu, Timing>(profiler);
+}
+
+//same as run() but every instruction is handed to the profiler (or tracer) first
+void Emulator::runProfiled(GuestProfiler & profiler, int maxFrames)
+{
+	runFrames(profiler, maxFrames);
+}
+
+void Emulator::runTraced(InstructionTracer & tracer, int maxFrames)
+{
+	runFrames(tracer, maxFrames);
+}
+
+
+/*Runs the loaded rom without a window until it reports a result over the serial port. The blargg test 
+roms finish by printing either "Passed" or "Failed" (possibly followed by the failing test #). A rom that 
+hasn't reported anything after maxFrames worth of cycles is considered to be hung.*/
+int Emulator::runTest(int maxFrames)
+{
+	NullProfiler profiler;
+
+	for (int frame = 0; frame < maxFrames; frame++)
+	{
+		runFrames(profiler, 1);
+
+		if (serialOutput.find("Passed") != std::string::npos)
+			return TEST_PASSED;
+		if (serialOutput.find("Failed") != std::string::npos)
+			return TEST_FAILED;
+	}
+
+	return TEST_TIMEOUT;
+}
+
+void Emulator::setPpu(PpuTier tier)
+{
+	ppuTier = tier;
+}
+
+void Emulator::setCpuTiming(CpuTiming timing)
+{
+	cpuTiming = timing;
+}
+
+const std::string & Emulator::getSerialOutput() const
+{
+	return serialOutput;
 }
 
 
@@ -191,10 +501,12 @@ it is about to overflow. If it does overflow then it resets the timer(TIMA) to t
 (TMA) and requests a timer interupt. */
 void Emulator::updateTimers(int cyc)
 {
+	syncTimers();
 	doDividerRegisters(cyc);
 
 	//the clock must be enabled to update the clock
-	if (isClockEnabled()) //checks a setting in the timer controller (TMC) which pauses or resumes the timer counting.
+	bool enabled = isClockEnabled(); //checks a setting in the timer controller (TMC) which pauses or resumes the timer counting.
+	if (enabled)
 	{
 		timerCounter -= cyc;
 
@@ -202,20 +514,37 @@ void Emulator::updateTimers(int cyc)
 		{
 			setClockFreq(); //reset timerCounter to the correct value for the current frequency
 
-			if (readMemory(TIMA) == 255) //check if the timer about to overflow
+			if (memory[TIMA] == 255) //check if the timer about to overflow
 			{
-				writeMemory(TIMA, readMemory(TMA)); //reset the timer to the value in the TMA
+				memory[TIMA] = memory[TMA]; //reset the timer to the value in the TMA
 				requestInterrupt(INTERRUPT_TIMER);
 			}
 
 			else
-				writeMemory(TIMA, readMemory(TIMA) + 1);
+				memory[TIMA]++;
 		}
 	}
+
+	//the first instruction that gets either counter to where it does something next
+	timersSyncedAt = totalCycles + cyc;
+	int due = 256 - dividerCounter;
+	if (enabled && timerCounter < due)
+		due = timerCounter;
+	nextTimerEvent = timersSyncedAt + due;
 	
 	return;
 } //in simple words based on the timerCounter (CLOCK/freq), we either update the time +1 or if timer is about to overflow, reset
 
+//counts the cycles updateTimers didn't get to see, none of them got DIV or TIMA to go up
+void Emulator::syncTimers()
+{
+	int cycles = (int)(totalCycles - timersSyncedAt);
+	dividerCounter += cycles;
+	if (isClockEnabled())
+		timerCounter -= cycles;
+	timersSyncedAt = totalCycles;
+}
+
 
 /*The way the Divider Register works is it continually counts up from 0 to 255 and then when it overflows it 
 starts from 0 again. It does not cause an interupt when it overflows and it cannot be paused 
@@ -278,6 +607,11 @@ void Emulator::requestInterrupt(int id)
 	return;
 }
 
+void Emulator::updateInterruptPending()
+{
+	interruptPending = (memory[0xFFFF] != 0) && (memory[0xFF0F] != 0);
+}
+
 void Emulator::handleInterrupts() //halted variable allows the reg_PC to be finally increased pass the halt instruction
 {
 	bool IE_set = (readMemory(0xFFFF) > 0) ? true : false; //check if IE = 1
@@ -342,109 +676,9 @@ void Emulator::serviceInterrupt(int interrupt)
 }
 
 
-void Emulator::handleEvents()
-{
-
-	while (SDL_PollEvent(&e) != 0)
-	{
-		switch (e.type)
-		{
-			case SDL_QUIT: quit = true; break;
-
-			case SDL_KEYDOWN:
-			{
-				if (e.key.repeat != 0) break;
-
-				if (e.key.keysym.sym == SDLK_UP)
-				{
-					keyPressed(BIT_2); break;
-				}
-				else if (e.key.keysym.sym == SDLK_DOWN)
-				{
-					keyPressed(BIT_3); break;
-				}
-				else if (e.key.keysym.sym == SDLK_LEFT)
-				{
-					keyPressed(BIT_1); break;
-				}
-				else if (e.key.keysym.sym == SDLK_RIGHT)
-				{
-					keyPressed(BIT_0); break;
-				}
-				else if (e.key.keysym.sym == SDLK_SPACE) //A
-				{ 
-					keyPressed(BIT_0); break;
-				}
-				else if (e.key.keysym.sym == SDLK_LCTRL) //B
-				{
-					keyPressed(BIT_1); break;
-				}
-				else if (e.key.keysym.sym == SDLK_RETURN) //Enter
-				{
-					keyPressed(BIT_2); break;
-				}
-				else if (e.key.keysym.sym == SDLK_RSHIFT) //Select
-				{
-					keyPressed(BIT_3); break;
-				}
-				else
-					break; //not one of the buttons -> do nothing
-			}
-
-			case SDL_KEYUP:
-			{
-				if (e.key.keysym.sym == SDLK_UP)
-				{
-					keyReleased(BIT_2); break;
-				}
-				else if (e.key.keysym.sym == SDLK_DOWN)
-				{
-					keyReleased(BIT_3); break;
-				}
-				else if (e.key.keysym.sym == SDLK_LEFT)
-				{
-					keyReleased(BIT_1); break;
-				}
-				else if (e.key.keysym.sym == SDLK_RIGHT)
-				{
-					keyReleased(BIT_0); break;
-				}
-				else if (e.key.keysym.sym == SDLK_SPACE) //A
-				{
-					keyReleased(BIT_0); break;
-				}
-				else if (e.key.keysym.sym == SDLK_LCTRL) //B
-				{
-					keyReleased(BIT_1); break;
-				}
-				else if (e.key.keysym.sym == SDLK_RETURN) //Enter
-				{
-					keyReleased(BIT_2); break;
-				}
-				else if (e.key.keysym.sym == SDLK_RSHIFT) //Select
-				{
-					keyReleased(BIT_3); break;
-				}
-				else
-					break; //not one of the buttons -> do nothing
-			}
-		}
-
-
-	}
-}
-
-
-void Emulator::keyPressed(int key)
+//key is the bit of the joypad register the button is, directional picks the d-pad over the buttons (see Display)
+void Emulator::keyPressed(int key, bool directional)
 {
-	
-	bool directional = false;
-
-	if (e.key.keysym.sym == SDLK_UP || e.key.keysym.sym == SDLK_DOWN || e.key.keysym.sym == SDLK_LEFT || e.key.keysym.sym == SDLK_RIGHT)
-	{
-		directional = true;
-	}
-
 	Byte joypad = (directional) ? joypadDirections : joypadButtons;
 	bool unpressed = testBit(joypad, key); //check if the button is being held down
 
@@ -461,15 +695,8 @@ void Emulator::keyPressed(int key)
 	return;
 }
 
-void Emulator::keyReleased(int key)
+void Emulator::keyReleased(int key, bool directional)
 {
-	bool directional = false;
-
-	if (e.key.keysym.sym == SDLK_UP || e.key.keysym.sym == SDLK_DOWN || e.key.keysym.sym == SDLK_LEFT || e.key.keysym.sym == SDLK_RIGHT)
-	{
-		directional = true;
-	}
-
 	Byte joy = (directional) ? joypadDirections : joypadButtons;
 	bool unpressed = testBit(joy, key);
 
@@ -1,72 +1,250 @@
 #pragma once
+#include <stddef.h>
 #include <stdio.h>
-#include <SDL.h>
 #include <stdlib.h>
+#include <string>
+#include <vector>
+#include <type_traits>
 #include "types.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "FrameStats.h"
+#include "IdleLoop.h"
+#include "CopyLoop.h"
+#include "TileMaps.h"
+#include "Ppu.h"
+#include "CpuTiming.h"
+#include "PixelFifo.h"
 
 #define TIMA 0xFF05 //actual timer which counts up @ a certain frequency
 #define TMA 0xFF06 //timer modulator (sets the frequency)
 #define TMC 0xFF07 //timer controller (enables/disables timer)
 
-class Emulator
+class BlockCache;
+class Display;
+class JitArena;
+struct AotFrame;
+
+//how instructions get executed, the interpreter is the reference the others are checked against
+enum CpuEngine
+{
+	CPU_INTERPRETER,
+	CPU_BLOCK_CACHE, //see BlockCache.h
+	CPU_JIT //hot blocks get compiled to x86-64, see Jit.h (only aot modules run natively on anything else)
+};
+
+//results of a headless test rom run (see runTest)
+enum TestStatus
+{
+	TEST_PASSED,
+	TEST_FAILED,
+	TEST_TIMEOUT,
+	TEST_NO_ROM
+};
+
+/*Everything the cpu touches on every instruction, kept together in one cache line at the very start of the 
+emulator instead of spread out between the io state, the framebuffers & memory (see Emulator::operator new)*/
+struct alignas(64) HotState
+{
+	/*The pairs are laid out so the 8 bit registers can also be picked by the register field of an opcode 
+	(see readR8), each pair is little endian like the Register union so the order is C B E D L H F A*/
+	union
+	{
+		struct
+		{
+			Register reg_BC;
+			Register reg_DE;
+			Register reg_HL;
+			Register reg_AF;
+		};
+		Byte registers[8];
+	};
+	Word reg_SP;
+	Word reg_PC;
+	int num_cycles; //taken by the instruction that's executing, catchUp hands them to the rest of the hardware
+
+	//see LazyFlags
+	Byte lazyOp;
+	Byte lazyTarget, lazyValue, lazyCarry, lazyResult;
+
+	bool interruptMasterEnable;
+	bool halted;
+
+	/*handleInterrupts only does anything when IE & IF are both non zero (whatever IME is, a halted cpu still 
+	wakes up), so that gets worked out whenever either register is written instead of after every instruction*/
+	bool interruptPending;
+
+	uint64_t totalCycles; //every clock cycle executed since power on
+	uint64_t nextTimerEvent; //updateTimers has to run for the instruction that gets totalCycles here
+
+	/*An oam dma takes 160 machine cycles, until totalCycles gets to dmaEndsAt the cpu can only get at the io 
+	registers & high ram (see doDMATransfer)*/
+	uint64_t dmaEndsAt;
+
+	/*Most of the time stepping the lcd only counts scanlineCounter down, nothing it does can be seen until the 
+	counter gets to the next mode or the end of the scanline. Until then catchUp just adds the cycles to 
+	graphicsPending (see updateGraphics), anything that reads the counter has to syncGraphics first.*/
+	int graphicsSlack; //cycles that can still be put off, < 0 when the next step has to be a real one
+	int graphicsPending;
+
+	//the last instruction a compiled block ran, address | cycles << 16 (< 0 if it didn't run any), see runNative
+	int nativeLast;
+};
+
+static_assert(sizeof(HotState) <= 64, "the hot state has to fit in one cache line");
+static_assert(offsetof(HotState, reg_BC) == 0, "the registers start the hot state");
+
+class Emulator : private HotState
 {
 public:
-	Emulator();
-	void loadRom(char * location);
+	Emulator(bool headless = false);
+	~Emulator();
+
+	//plain new only lines the object up to 16 bytes before C++17
+	static void * operator new(size_t size);
+	static void operator delete(void * object);
+	bool loadRom(const char * location);
+	void setCpuEngine(CpuEngine engine);
+	void setPpu(PpuTier tier);
+	void setCpuTiming(CpuTiming timing);
+	void setTranslationCache(bool enabled); //before loadRom, keeps the block cache in <rom>.tcache between runs
+	void setAotModule(const char * path); //before loadRom, runs on CPU_JIT with the blocks from a module built by -aot
+	bool writeAotModule(const char * romLocation, const char * outPath); //after loadRom, see Aot.h
 	void run();
+	void runProfiled(GuestProfiler & profiler, int maxFrames);
+	void runTraced(InstructionTracer & tracer, int maxFrames);
+	int runTest(int maxFrames);
+	const std::string & getSerialOutput() const;
 	
 	void parseBitOp(Byte code);
 	void parseOpcode(Byte code);
 
 	void executeNextOpcode();
 	void updateTimers(int cyc);
+
+	//instruction handlers that get handed operands that were already fetched (see decodedOpcodeTable)
+	typedef void (Emulator::*DecodedOpcodeHandler)(Byte value, Byte value2);
+
+	/*What compiled code calls for everything it doesn't do itself (see Jit.h), the operands are packed into 
+	ints so they fit in argument registers on every abi: op is code | value << 8 | value2 << 16 | length << 24, 
+	write is address | value << 16 | length << 24 & cycles is pending | instruction cycles << 16. Both return 
+	how many cycles the hardware stays quiet for now, < 0 when the block has to be left.*/
+	static Byte nativeRead(Emulator * emu, int address);
+	static int nativeStore(Emulator * emu, int write, int pc, int cycles);
+	static int nativeExecute(Emulator * emu, int op, int pc, int pending);
 	
 private:
 	bool quit;
+	bool headless; //no window, nothing gets presented (used by the test rom runner)
+
+	//the run loop is instantiated once per profiler type, ppu tier & cpu timing, see Profiler.h, Ppu.h & CpuTiming.h
+	friend class GuestProfiler;
+	friend class InstructionTracer;
+	friend class BlockCache;
+	friend class JitArena;
+	friend class IdleLoop;
+	friend class CopyLoop;
+	friend class Display;
+	friend struct ScanlinePpu;
+	friend struct PixelFifoPpu;
+	friend class PixelFifo;
+	friend struct MCycleTiming;
+	PpuTier ppuTier;
+	CpuTiming cpuTiming;
+	int handedOverCycles; //of the executing instruction, MCycleTiming already gave them to the timers & lcd
+	IdleLoop idleLoop;
+	CopyLoop copyLoop;
+	BlockCache * blockCache; //NULL when running on CPU_INTERPRETER
+	JitArena * jit; //NULL unless running on CPU_JIT
+	uint64_t nativeStart; //totalCycles when the compiled block that's executing was entered
+	int nativeBudget; //it can't run any instruction that would take it past this many cycles
+	uint32_t nativeKey; //the block cache key of the jit block that was left (it can chain on to others), ~0 when it isn't one
+	bool translationCache;
+	std::string translationCachePath; //empty unless a rom was loaded with the translation cache on
+	void loadTranslationCache(const char * romLocation);
+	void saveTranslationCache();
+	uint64_t romChecksum() const;
+	std::string aotModulePath;
+	void * aotLibrary;
+	void loadAotModule();
+	void unloadAotModule();
+
+	//the rest of what an aot module's code calls back into (see AotRuntime)
+	static void aotFrame(Emulator * emu, AotFrame * frame);
+	static void aotLeave(Emulator * emu, int cycles, int pc, int last);
+	static void aotHalt(Emulator * emu, int cycles, int pc, int quiet);
+	void executeCachedOpcode();
+	int runNative(int budget);
+	int nativeQuiet() const;
+	void nativeFlush(int cycles);
+	int nativeSynced(Address pc, int length, int cycles);
+	template <class Profiler> void runFrames(Profiler & profiler, int maxFrames);
+	template <class Ppu, class Timing, class Profiler> void runFrames(Profiler & profiler, int maxFrames);
+	template <class Ppu, class Timing, class Profiler> void runLoop(Profiler & profiler);
+	template <class Ppu, class Timing, class Profiler> int runFrame(Profiler & profiler);
+	template <class Ppu, class Timing, class Profiler> int step(Profiler & profiler);
+	template <class Ppu, class Timing, class Profiler> int advance(Profiler & profiler, int budget);
+	template <class Ppu, class Timing> int advance(NullProfiler & profiler, int budget);
+	template <class Ppu> void catchUp(int cycles); //compiled blocks & idle loops only ever use ScanlinePpu's
+	int quietCycles(int limit, int lastCycles);
+	void fastForward(int cycles);
 //====================================//	
 	//DRAWING
-	SDL_Rect rec;
-	SDL_Surface * bgSurf;
-	SDL_Surface * windowSurf;
-	SDL_Surface * spriteSurf;
-	SDL_Texture * texture;
-
-	SDL_Window * window;
-	SDL_Surface * screenSurface;
-	SDL_Event e;
-
-	void renderBackground();
-	void renderWindow();
+	Display * display; //the window & keyboard, NULL when headless
+
+	FrameStats frameStats;
+	bool showFrameStats; //F1 puts a summary of frameStats in the window title
+
+	void renderBackground(Byte line);
+	void renderWindow(Byte line);
 	void renderSprites();
-	int getColour(Byte palette, Byte top, Byte bottom, int bit, bool isSprite);
+	uint32_t getColour(Byte palette, int colorCode, bool isSprite);
+	void updatePalettes();
 	void initDisplay();
-	void destroySDL();
-	void renderSpriteTiles(Byte palette, int startX, int startY, Byte tileID, Byte flags);
+	void renderSpriteTiles(const uint32_t * colours, int startX, int startY, Byte tileID, Byte flags);
 
 	void setLCDStatus();
 	bool isLCDEnabled() const;
-	void drawScanLine();
+	int lcdBand(int counter) const;
+	static int lcdBandEnd(int band);
+	void drawScanLine(Byte line);
+	void drawPendingLines();
 	void doDMATransfer(Byte data);
 	void updateGraphics(int cyc);
+	void syncGraphics();
+	void catchUpGraphics();
 	void renderScreen();
+	PixelFifo pixelFifo; //the lcd when running on PPU_PIXEL_FIFO, updateGraphics & the scanline state below go unused then
 
 
 	int scanlineCounter = 456;
+
+	/*Scanlines that have finished but haven't been drawn yet. They get drawn together right before anything 
+	drawing them would look at changes (vram, oam, the lcd control, scroll, window & palette registers), 
+	before the frame gets shown & at the end of every run loop frame (see drawPendingLines).*/
+	Byte undrawnFrom = 0;
+	int undrawnLines = 0;
+	TileMaps tileMaps; //what renderBackground & renderWindow copy their rows from
+
+	//the sprites that can be on screen in the order they get drawn, only worked out again after oam changes
+	Byte visibleSprites[40];
+	int visibleSpriteCount = 0;
+	bool oamDirty = true;
+	void findVisibleSprites();
 	uint32_t bgData[144 * 160];
-	uint32_t garbage[144 * 166];
 	uint32_t windowData[144 * 160];
 	uint32_t spriteData[144 * 160];
 	uint32_t colorShades[4];
+
+	//the colour each colour number comes out as under BGP, OBP0 & OBP1 (see updatePalettes)
+	uint32_t backgroundColours[4];
+	uint32_t windowColours[4];
+	uint32_t spriteColours[2][4];
 //====================================//
 	//CPU
 	Byte memory[0x10000];
+	std::vector<Byte> cartridgeMemory; //whole cartridge (up to 2MB), one per instance so emulators can run side by side
 	
-	Register reg_AF;
-	Register reg_BC;
-	Register reg_DE;
-	Register reg_HL;
-	Word reg_SP;
-	Word reg_PC;
 
 //====================================//
 	//MEMORY MANAGEMENT
@@ -97,12 +275,29 @@ private:
 	void writeMemory(Word address, Byte data);
 	Byte readMemory(Word address) const;
 
+	/*Where each 4KB page of the address space can be read straight from, follows the current rom & ram bank. 
+	The last page is NULL because it holds the io registers which need readMemory. Only used to fetch 
+	instructions & their operands (see fetch).*/
+	const Byte * readPages[16];
+	void mapReadPages();
+	Byte fetch(int offset);
+
+	/*The code byte at address the way fetch sees it, without the side effects of readMemory or its oam dma bus 
+	block. What the profiler, tracer & loop decoders read instructions with.*/
+	Byte peekCode(Address address) const;
+
 	bool m_MBC1;
 	bool m_MBC2;
 
+	/*Blargg's test roms print their results through the serial port: the byte is placed in SB (0xFF01) 
+	and a transfer is started by writing 0x81 to SC (0xFF02). Nothing is plugged into the link port so 
+	we just keep every transferred byte around to be inspected.*/
+	std::string serialOutput;
+
 //====================================//
 	//TIMING
 	void doDividerRegisters(int cyc);
+	void syncTimers();
 	void setClockFreq();
 	bool isClockEnabled();
 	Byte getClockFreq() const;
@@ -117,7 +312,13 @@ private:
 	const int MAXCYCLES = CLOCK / frameRate;
 	int timerCounter = CLOCK / frequency;
 	int dividerCounter = 0;
-	int num_cycles;
+
+	/*The divider & timer only do something when DIV goes up or TIMA ticks, in between all updateTimers did was 
+	count dividerCounter & timerCounter. They're only brought up to date when they get used: once totalCycles 
+	gets to nextTimerEvent, when TMC changes & when something needs to look at them (see syncTimers).*/
+	uint64_t timersSyncedAt = 0; //totalCycles the two counters have been counted up to
+
+	static const int DMA_CYCLES = 640; //how long an oam dma keeps the cpu off the bus, see dmaEndsAt
 
 //====================================//
 	/*There are two special registers to do with the state of interrupt handling in the gameboy.
@@ -151,50 +352,76 @@ private:
 	void requestInterrupt(int id);
 	void handleInterrupts();
 	void serviceInterrupt(int interrupt);
-	bool interruptMasterEnable;
-	bool halted;
+	void updateInterruptPending();
 
 //====================================//
 	//INPUT
 	Byte joypadButtons;
 	Byte joypadDirections;
-	void handleEvents();
-	void keyPressed(int key);
-	void keyReleased(int key);
+	void keyPressed(int key, bool directional);
+	void keyReleased(int key, bool directional);
 	Byte getJoypadState() const;
 
 //====================================//
 	//CPU INSTRS
+	//one handler per opcode, generated from the opcode's bit fields (see opcode.cpp)
+	typedef void (Emulator::*OpcodeHandler)();
+	typedef void (Emulator::*BitOpHandler)();
+	static const OpcodeHandler opcodeTable[256]; //fetch their own operands
+	static const DecodedOpcodeHandler decodedOpcodeTable[256]; //get handed operands that were already fetched
+	static const BitOpHandler bitOpTable[256];
+	static const OpcodeHandler mcycleOpcodeTable[256]; //opcodeTable & bitOpTable on MCycleTiming
+	static const BitOpHandler mcycleBitOpTable[256];
+	template <int OP, class Timing = InstructionTiming> void interpretOpcode();
+	template <int OP, class Timing = InstructionTiming> void executeOpcode(Byte value, Byte value2);
+	template <int OP, class Timing = InstructionTiming> void executeBitOp();
+	template <int OP> void interpretMCycleOpcode();
+	template <int OP> void executeMCycleBitOp();
+	void executeMCycleOpcode();
+	template <class Timing> Byte readR8(int r);
+	template <class Timing> void writeR8(int r, Byte data);
+	void alu(int operation, Byte value);
+	bool condition(int cc);
+
+	/*Lazy flags: ADD ADC SUB SBC CP AND OR XOR INC & DEC only record their operands & result, F gets worked 
+	out from them when something actually reads it (conditions, carry in, DAA, PUSH AF...) through flags(). 
+	Most of the time the next alu op overwrites them before anything looks.*/
+	enum LazyFlags : Byte
+	{
+		FLAGS_READY, //reg_AF.lo is up to date
+		LAZY_ADD,
+		LAZY_ADC,
+		LAZY_SUB, //SUB & CP
+		LAZY_SBC,
+		LAZY_AND,
+		LAZY_OR_XOR,
+		LAZY_INC,
+		LAZY_DEC
+	};
+	void setLazyFlags(Byte operation, Byte target, Byte value, Byte carry, Byte result);
+	Byte computeFlags() const;
+	Byte flags();
+
 	void op(int pc, int cycle);
 	void set_flag(int flag, bool value);
 	void LD(Byte & destination, Byte value);
-	void LD(Byte& destination, Address addr);
-	void LD(Address addr, Byte value);
+	template <class Timing> void LD(Byte& destination, Address addr);
+	template <class Timing> void LD(Address addr, Byte value);
 	void LD(Register & pair, Byte upper, Byte lower);
 	void LDHL(Byte value);
-	void LDNN(Byte low, Byte high);
-	void PUSH(Byte high, Byte low);
-	void POP(Byte & high, Byte & low);
+	template <class Timing> void LDNN(Byte low, Byte high);
+	template <class Timing> void PUSH(Byte high, Byte low);
+	template <class Timing> void POP(Byte & high, Byte & low);
 	void ADD(Byte & target, Byte value);
-	void ADD(Byte & target, Address addr);
 	void ADC(Byte & target, Byte value);
-	void ADC(Byte & target, Address addr);
 	void SUB(Byte & target, Byte value);
-	void SUB(Byte & target, Address addr);
 	void SBC(Byte & target, Byte value);
-	void SBC(Byte & target, Address addr);
 	void AND(Byte & target, Byte value);
-	void AND(Byte & target, Address addr);
 	void OR(Byte & target, Byte value);
-	void OR(Byte & target, Address addr);
 	void XOR(Byte & target, Byte value);
-	void XOR(Byte & target, Address addr);
 	void CP(Byte & target, Byte value);
-	void CP(Byte & target, Address addr);
 	void INC(Byte & target);
-	void INC(Address addr);
 	void DEC(Byte & target);
-	void DEC(Address addr);
 	void ADD16(Word target, Word value);
 	void ADDHL(Register & pair);
 	void ADDHLSP();
@@ -204,50 +431,24 @@ private:
 	void DEC(Register & pair);
 	void DECSP();
 	void SL(Byte & target);
-	void SL(Address addr);
 	void SR(Byte & target, bool include_top_bit);
-	void SR(Address addr, bool include_top_bit);
 	void RL(Byte & target, bool carry, bool zero_flag = false);
-	void RL(Address addr, bool carry);
 	void RR(Byte & target, bool carry, bool zero_flag = false);
-	void RR(Address addr, bool carry);
 	void SRA(Byte & target);
-	void SRA(Address addr);
 	void SRL(Byte & target);
-	void SRL(Address addr);
 	void SWAP(Byte & target);
-	void SWAP(Address addr);
 	void BIT(Byte target, int bit);
-	void BIT(Address addr, int bit);
 	void SET(Byte & target, int bit);
-	void SET(Address addr, int bit);
 	void RES(Byte & target, int bit);
-	void RES(Address addr, int bit);
 	void SCF();
 	void CCF();
 	void JP(Register target);
-	void JPNZ(Register target);
-	void JPZ(Register target);
-	void JPNC(Register target);
-	void JPC(Register target);
 	void JR(Byte value);
-	void JRNZ(Byte value);
-	void JRZ(Byte value);
-	void JRNC(Byte value);
-	void JRC(Byte value);
 	void JPHL();
-	void CALL(Byte low, Byte high);
-	void CALLNZ(Byte low, Byte high);
-	void CALLZ(Byte low, Byte high);
-	void CALLNC(Byte low, Byte high);
-	void CALLC(Byte low, Byte high);
-	void RET();
-	void RETI();
-	void RETNZ();
-	void RETZ();
-	void RETNC();
-	void RETC();
-	void RST(Address addr);
+	template <class Timing> void CALL(Byte low, Byte high);
+	template <class Timing> void RET();
+	template <class Timing> void RETI();
+	template <class Timing> void RST(Address addr);
 	void DAA();
 	void CPL();
 	void NOP();
@@ -255,4 +456,13 @@ private:
 	void STOP();
 	void DI();
 	void EI();
-};
\ No newline at end of file
+};
+
+//HotState is the only base, without a vtable in front of it reg_BC is the first byte of an Emulator
+static_assert(!std::is_polymorphic<Emulator>::value, "the hot state has to start the emulator");
+
+//disassembler (opcode.cpp)
+int emulator_disassemble(Address addr, Byte code, Byte value, Byte value2, char * buffer, size_t size);
+const char * emulator_mnemonic(Byte code, bool cb_prefixed);
+int emulator_opcode_length(Byte code);
+int emulator_opcode_cycles(Byte code, Byte cbCode, bool taken);
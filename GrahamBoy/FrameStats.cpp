@@ -0,0 +1,120 @@
+#include "FrameStats.h"
+#include "FrameTrace.h"
+#include <string.h>
+
+static const double CPU_CLOCK = 4194304.0;
+static const double REFRESH_PERIOD_NS = 70224.0 / CPU_CLOCK * 1e9; //~16.74ms --> 59.73Hz
+
+FrameStats::FrameStats()
+{
+	memset(frameTimes, 0, sizeof(frameTimes));
+	memset(jitter, 0, sizeof(jitter));
+	memset(recentFrameTimes, 0, sizeof(recentFrameTimes));
+	memset(recentJitter, 0, sizeof(recentJitter));
+	frames = repeatedFrames = skippedFrames = longestFrame = 0;
+	jitterTotal = 0;
+	firstTime = lastTime = 0;
+	firstCycles = lastCycles = 0;
+	summaryTime = summaryCycles = summaryFrames = 0;
+	summaryRepeated = summarySkipped = 0;
+}
+
+void FrameStats::framePresented(uint64_t emulatedCycles)
+{
+	uint64_t now = FrameTrace::now();
+
+	if (frames == 0)
+	{
+		firstTime = summaryTime = now;
+		firstCycles = summaryCycles = emulatedCycles;
+	}
+	else
+	{
+		uint64_t frameTime = now - lastTime;
+		double offBy = (double)frameTime - REFRESH_PERIOD_NS;
+		if (offBy < 0)
+			offBy = -offBy;
+
+		uint64_t bucket = frameTime / BUCKET_NS;
+		frameTimes[bucket < BUCKETS ? bucket : BUCKETS]++;
+		recentFrameTimes[bucket < BUCKETS ? bucket : BUCKETS]++;
+		bucket = (uint64_t)offBy / BUCKET_NS;
+		jitter[bucket < BUCKETS ? bucket : BUCKETS]++;
+		recentJitter[bucket < BUCKETS ? bucket : BUCKETS]++;
+		jitterTotal += offBy;
+
+		if (frameTime > longestFrame)
+			longestFrame = frameTime;
+
+		//how many screen refreshes this frame covered, rounded to the nearest one
+		uint64_t refreshes = (uint64_t)((double)frameTime / REFRESH_PERIOD_NS + 0.5);
+		if (refreshes > 1)
+			repeatedFrames += refreshes - 1;
+		else if (refreshes == 0)
+			skippedFrames++;
+	}
+
+	lastTime = now;
+	lastCycles = emulatedCycles;
+	frames++;
+}
+
+//value (in ms) below which the given fraction of the frames fell, resolution is the bucket size
+double FrameStats::percentile(const uint32_t * histogram, double fraction)
+{
+	uint64_t total = 0;
+	for (int i = 0; i <= BUCKETS; i++)
+		total += histogram[i];
+
+	if (total == 0)
+		return 0;
+
+	uint64_t target = (uint64_t)(total * fraction);
+	uint64_t seen = 0;
+	for (int i = 0; i <= BUCKETS; i++)
+	{
+		seen += histogram[i];
+		if (seen > target)
+			return (i + 1) * BUCKET_NS / 1e6;
+	}
+
+	return (BUCKETS + 1) * BUCKET_NS / 1e6;
+}
+
+void FrameStats::summary(char * out, size_t size)
+{
+	double seconds = (lastTime - summaryTime) / 1e9;
+	double fps = seconds > 0 ? (frames - summaryFrames) / seconds : 0;
+	double speed = seconds > 0 ? (lastCycles - summaryCycles) / seconds / CPU_CLOCK * 100 : 0;
+
+	snprintf(out, size, "Gameboy Emulator | %.1f fps | speed %.0f%% | p50 %.1fms p99 %.1fms | jitter p99 %.1fms | repeated %llu skipped %llu",
+		fps, speed, percentile(recentFrameTimes, 0.5), percentile(recentFrameTimes, 0.99), percentile(recentJitter, 0.99),
+		(unsigned long long)(repeatedFrames - summaryRepeated), (unsigned long long)(skippedFrames - summarySkipped));
+
+	summaryTime = lastTime;
+	summaryCycles = lastCycles;
+	summaryFrames = frames;
+	summaryRepeated = repeatedFrames;
+	summarySkipped = skippedFrames;
+	memset(recentFrameTimes, 0, sizeof(recentFrameTimes));
+	memset(recentJitter, 0, sizeof(recentJitter));
+}
+
+void FrameStats::report(FILE * out) const
+{
+	if (frames < 2)
+		return;
+
+	uint64_t intervals = frames - 1;
+	double seconds = (lastTime - firstTime) / 1e9;
+
+	fprintf(out, "frames presented: %llu in %.1fs (%.2f fps, target %.2f)\n", (unsigned long long)frames, seconds,
+		intervals / seconds, 1e9 / REFRESH_PERIOD_NS);
+	fprintf(out, "emulation speed: %.1f%%\n", (lastCycles - firstCycles) / seconds / CPU_CLOCK * 100);
+	fprintf(out, "frame time: p50 %.1fms  p95 %.1fms  p99 %.1fms  max %.1fms\n", percentile(frameTimes, 0.5),
+		percentile(frameTimes, 0.95), percentile(frameTimes, 0.99), longestFrame / 1e6);
+	fprintf(out, "jitter vs %.2fms: mean %.2fms  p95 %.1fms  p99 %.1fms\n", REFRESH_PERIOD_NS / 1e6,
+		jitterTotal / intervals / 1e6, percentile(jitter, 0.95), percentile(jitter, 0.99));
+	fprintf(out, "repeated frames: %llu  skipped frames: %llu\n", (unsigned long long)repeatedFrames,
+		(unsigned long long)skippedFrames);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+
+/*Frame time & pacing statistics for the presented frames. Everything is kept in fixed size histograms 
+so recording a frame never allocates, which means it can be left on for long running sessions.
+
+A real gameboy refreshes its screen 4194304 / 70224 = ~59.73 times a second. A host frame that took more 
+than one of those periods means the previous image got shown again (repeated), while one that came less 
+than half a period after the previous one would be replaced before the screen ever showed it (skipped).*/
+class FrameStats
+{
+public:
+	FrameStats();
+
+	//call straight after presenting, emulatedCycles is the total clock cycles the cpu has run so far
+	void framePresented(uint64_t emulatedCycles);
+
+	//one line summary of the last second or so, for the window title overlay
+	void summary(char * out, size_t size);
+	void report(FILE * out) const;
+
+	uint64_t framesPresented() const { return frames; }
+
+private:
+	static const int BUCKETS = 1000; //0.1ms each so 0-100ms, anything longer goes in the last bucket
+	static const uint64_t BUCKET_NS = 100000;
+
+	uint32_t frameTimes[BUCKETS + 1];
+	uint32_t jitter[BUCKETS + 1]; //how far each frame time was from the gameboy's refresh period
+
+	//the same two for just the frames since the last summary(), which starts them over
+	uint32_t recentFrameTimes[BUCKETS + 1];
+	uint32_t recentJitter[BUCKETS + 1];
+
+	uint64_t frames;
+	uint64_t repeatedFrames;
+	uint64_t skippedFrames;
+	uint64_t longestFrame;
+	double jitterTotal;
+
+	uint64_t firstTime, lastTime;
+	uint64_t firstCycles, lastCycles;
+	uint64_t summaryTime, summaryCycles, summaryFrames; //where the last summary() left off
+	uint64_t summaryRepeated, summarySkipped;
+
+	static double percentile(const uint32_t * histogram, double fraction);
+};
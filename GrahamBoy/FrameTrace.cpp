@@ -0,0 +1,96 @@
+#include "FrameTrace.h"
+#include <stdio.h>
+#include <vector>
+#include <mutex>
+
+bool FrameTrace::enabled = false;
+size_t FrameTrace::capacity = 0;
+
+struct PhaseEvent
+{
+	const char * name; //always a string literal so only the pointer needs keeping
+	uint64_t start;
+	uint64_t duration;
+};
+
+//one per thread, the oldest events get overwritten once it's full
+struct PhaseBuffer
+{
+	std::vector<PhaseEvent> events;
+	uint64_t written;
+	int thread;
+};
+
+static std::mutex s_buffers_lock;
+static std::vector<PhaseBuffer *> s_buffers; //every thread's buffer, kept around after the thread exits so it can be exported
+static thread_local PhaseBuffer * t_buffer = NULL;
+
+void FrameTrace::enable(size_t eventsPerThread)
+{
+	capacity = eventsPerThread ? eventsPerThread : 1;
+	enabled = true;
+}
+
+void FrameTrace::record(const char * name, uint64_t start, uint64_t duration)
+{
+	//the first event on a thread allocates its buffer, from then on recording is just a store
+	if (t_buffer == NULL)
+	{
+		t_buffer = new PhaseBuffer();
+		t_buffer->events.resize(capacity);
+		t_buffer->written = 0;
+
+		std::lock_guard<std::mutex> lock(s_buffers_lock);
+		t_buffer->thread = (int)s_buffers.size() + 1;
+		s_buffers.push_back(t_buffer);
+	}
+
+	PhaseEvent & event = t_buffer->events[t_buffer->written % t_buffer->events.size()];
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+	t_buffer->written++;
+}
+
+/*Writes the events as "complete" (ph X) events, timestamps are in microseconds relative to the first event. 
+Should only be called once the threads being traced have stopped recording.*/
+bool FrameTrace::exportJson(const char * path)
+{
+	FILE * out;
+	if (fopen_s(&out, path, "w") != 0 || out == NULL)
+		return false;
+
+	std::lock_guard<std::mutex> lock(s_buffers_lock);
+
+	uint64_t origin = UINT64_MAX;
+	for (const PhaseBuffer * buffer : s_buffers)
+	{
+		size_t count = (buffer->written < buffer->events.size()) ? (size_t)buffer->written : buffer->events.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (buffer->events[i].start < origin)
+				origin = buffer->events[i].start;
+		}
+	}
+
+	fprintf(out, "{\"traceEvents\":[\n");
+	fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GrahamBoy\"}}");
+
+	for (const PhaseBuffer * buffer : s_buffers)
+	{
+		fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"emulator %d\"}}", buffer->thread, buffer->thread);
+
+		//oldest first
+		uint64_t count = (buffer->written < buffer->events.size()) ? buffer->written : buffer->events.size();
+		for (uint64_t i = buffer->written - count; i < buffer->written; i++)
+		{
+			const PhaseEvent & event = buffer->events[i % buffer->events.size()];
+			fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				event.name, buffer->thread, (event.start - origin) / 1000.0, event.duration / 1000.0);
+		}
+	}
+
+	fprintf(out, "\n]}\n");
+	fclose(out);
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+
+/*Lightweight timers for the phases of a frame (event handling, running the cpu, drawing scanlines, 
+rendering & presenting). Each thread records into its own fixed size ring buffer so timing a phase 
+never allocates or takes a lock, and the result can be exported in the Chrome trace event format 
+(open it in chrome://tracing or ui.perfetto.dev) to see which phase made a frame blow its budget.
+
+Nothing gets recorded unless FrameTrace::enable has been called.*/
+
+const uint64_t FRAME_BUDGET_NS = 16700000; //one frame @ 60fps
+class FrameTrace
+{
+public:
+	static void enable(size_t eventsPerThread);
+	static bool isEnabled() { return enabled; }
+
+	static uint64_t now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static void record(const char * name, uint64_t start, uint64_t duration);
+	static bool exportJson(const char * path);
+
+private:
+	static bool enabled;
+	static size_t capacity;
+};
+
+//times everything from its construction to the end of the scope
+class ScopedPhase
+{
+public:
+	ScopedPhase(const char * name)
+	{
+		this->name = FrameTrace::isEnabled() ? name : NULL;
+		start = this->name ? FrameTrace::now() : 0;
+	}
+
+	~ScopedPhase()
+	{
+		if (name)
+			FrameTrace::record(name, start, FrameTrace::now() - start);
+	}
+
+	//renames the phase before it gets recorded (e.g. to flag a frame that went over budget)
+	void rename(const char * name)
+	{
+		if (this->name)
+			this->name = name;
+	}
+
+	uint64_t elapsed() const { return name ? FrameTrace::now() - start : 0; }
+
+private:
+	const char * name;
+	uint64_t start;
+};
@@ -0,0 +1,247 @@
+#include "IdleLoop.h"
+#include "Emulator.h"
+#include <string.h>
+
+IdleLoop::IdleLoop()
+{
+	state = LOOP_WATCHING;
+	count = 0;
+	position = 0;
+	nextPC = 0;
+	iterationCycles = 0;
+	rejectedStart = rejectedJump = 0;
+	rejectedBank = 0;
+}
+
+//instructions that only read memory & change registers (F, SP & PC included) can be part of an idle loop
+IdleLoop::ReadKind IdleLoop::classify(Byte code, Byte cbCode)
+{
+	int x = code >> 6, y = (code >> 3) & 7, z = code & 7;
+
+	switch (code)
+	{
+	case 0x00: //NOP
+	case 0x07: case 0x0F: case 0x17: case 0x1F: case 0x27: case 0x2F: case 0x37: case 0x3F: //rotate A, DAA, CPL, SCF, CCF
+	case 0x03: case 0x13: case 0x23: case 0x33: case 0x0B: case 0x1B: case 0x2B: case 0x3B: //INC/DEC rr
+	case 0x09: case 0x19: case 0x29: case 0x39: //ADD HL,rr
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: //JR
+	case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA: //JP
+		return READS_NOTHING;
+	case 0x0A: return READS_BC;
+	case 0x1A: return READS_DE;
+	case 0xFA: return READS_ADDRESS;
+	case 0xF0: return READS_HIGH;
+	case 0xF2: return READS_HIGH_C;
+	case 0x76: return NOT_ALLOWED; //HALT
+	case 0xCB:
+		if ((cbCode & 7) != 6)
+			return READS_NOTHING;
+		return ((cbCode >> 6) == 1) ? READS_HL : NOT_ALLOWED; //BIT b,[hl] only reads
+	}
+
+	if (x == 0 && (z == 4 || z == 5 || z == 6)) //INC r, DEC r, LD r,n
+		return (y == 6) ? NOT_ALLOWED : READS_NOTHING;
+	if (x == 1) //LD r,r
+		return (y == 6) ? NOT_ALLOWED : (z == 6) ? READS_HL : READS_NOTHING;
+	if (x == 2) //ALU A,r
+		return (z == 6) ? READS_HL : READS_NOTHING;
+	if (x == 3 && z == 6) //ALU A,n
+		return READS_NOTHING;
+
+	return NOT_ALLOWED;
+}
+
+//start is where the backward jump at jump went, every instruction in between has to be allowed
+bool IdleLoop::decode(const Emulator & emu, Address start, Address jump)
+{
+	count = 0;
+	Address pc = start;
+
+	while (pc <= jump && count < MAX_LOOP_OPS)
+	{
+		Byte code = emu.peekCode(pc);
+		Byte cbCode = (code == 0xCB) ? emu.peekCode(pc + 1) : 0;
+		int length = emulator_opcode_length(code);
+
+		Step & step = steps[count++];
+		step.pc = pc;
+		step.reads = classify(code, cbCode);
+		step.operand = (length > 1) ? emu.peekCode(pc + 1) : 0;
+		if (length > 2)
+			step.operand |= emu.peekCode(pc + 2) << 8;
+
+		if (step.reads == NOT_ALLOWED)
+			return false;
+
+		if (pc == jump) //has to be the jump back to the start
+		{
+			if (code == 0x18 || code == 0x20 || code == 0x28 || code == 0x30 || code == 0x38)
+				return (Address)(pc + 2 + (Byte_Signed)step.operand) == start;
+			if (code == 0xC3 || code == 0xC2 || code == 0xCA || code == 0xD2 || code == 0xDA)
+				return step.operand == start;
+			return false;
+		}
+
+		pc += length;
+	}
+
+	return false;
+}
+
+//the state before the instruction at position & the byte it's about to read
+void IdleLoop::record(const Emulator & emu)
+{
+	Step & step = steps[position];
+	capture(emu, step.before);
+
+	const Byte * r = step.before.registers; //C B E D L H F A
+	switch (step.reads)
+	{
+	case READS_HL: step.readAddress = r[4] | (r[5] << 8); break;
+	case READS_BC: step.readAddress = r[0] | (r[1] << 8); break;
+	case READS_DE: step.readAddress = r[2] | (r[3] << 8); break;
+	case READS_ADDRESS: step.readAddress = step.operand; break;
+	case READS_HIGH: step.readAddress = 0xFF00 + step.operand; break;
+	case READS_HIGH_C: step.readAddress = 0xFF00 + r[0]; break;
+	default: step.readAddress = -1; break;
+	}
+
+	step.readValue = (step.readAddress >= 0) ? emu.readMemory((Address)step.readAddress) : 0;
+}
+
+void IdleLoop::instructionDone(Emulator & emu, int cycles)
+{
+	Address executed = nextPC;
+	nextPC = emu.reg_PC;
+
+	if (state == LOOP_RECORDING && executed == steps[position].pc)
+	{
+		steps[position++].cycles = cycles;
+
+		if (position < count && emu.reg_PC == steps[position].pc)
+		{
+			record(emu);
+			return;
+		}
+
+		if (position == count && emu.reg_PC == steps[0].pc) //went round the loop once
+		{
+			CpuSnapshot now;
+			capture(emu, now);
+			position = 0;
+
+			if (sameState(now, steps[0].before))
+			{
+				state = LOOP_FOUND;
+				iterationCycles = 0;
+				for (int i = 0; i < count; i++)
+					iterationCycles += steps[i].cycles;
+			}
+			else
+				record(emu); //something's still counting, keep watching it
+			return;
+		}
+	}
+
+	//left the loop (or an instruction got executed instead of a found loop being skipped)
+	state = LOOP_WATCHING;
+
+	if (emu.reg_PC < executed && executed - emu.reg_PC <= MAX_LOOP_BYTES)
+	{
+		Address start = emu.reg_PC;
+		if (start == rejectedStart && executed == rejectedJump && emu.currentRomBank == rejectedBank)
+			return;
+
+		if (decode(emu, start, executed))
+		{
+			state = LOOP_RECORDING;
+			position = 0;
+			record(emu);
+		}
+		else if (start < 0x8000) //rom can't change under it
+		{
+			rejectedStart = start;
+			rejectedJump = executed;
+			rejectedBank = emu.currentRomBank;
+		}
+	}
+}
+
+int IdleLoop::skip(Emulator & emu, int budget)
+{
+	int skipped = 0;
+
+	while (state == LOOP_FOUND)
+	{
+		if (position == 0)
+		{
+			int cycles = bulkCycles(emu, budget - skipped);
+			if (cycles > 0)
+			{
+				emu.fastForward(cycles);
+				skipped += cycles;
+			}
+		}
+
+		const Step & step = steps[position];
+		if (step.readAddress >= 0 && emu.readMemory((Address)step.readAddress) != step.readValue)
+		{
+			restore(emu, step.before); //runs for real from here
+			state = LOOP_WATCHING;
+			break;
+		}
+
+		int next = (position + 1 == count) ? 0 : position + 1;
+		restore(emu, steps[next].before);
+		emu.num_cycles = step.cycles;
+		emu.catchUp<ScanlinePpu>(step.cycles);
+		skipped += step.cycles;
+		position = next;
+
+		if (emu.reg_PC != steps[next].before.pc) //took an interrupt
+			state = LOOP_WATCHING;
+		else if (skipped > budget)
+			break;
+	}
+
+	nextPC = emu.reg_PC;
+	return skipped;
+}
+
+//whole iterations the hardware can be given in one go, the jump back to the start was the last instruction replayed
+int IdleLoop::bulkCycles(Emulator & emu, int remaining) const
+{
+	if (iterationCycles <= 0)
+		return 0;
+
+	//a byte can change while the instructions after the one that read it get replayed, every read has to still match
+	for (int i = 0; i < count; i++)
+	{
+		if (steps[i].readAddress >= 0 && emu.readMemory((Address)steps[i].readAddress) != steps[i].readValue)
+			return 0;
+	}
+
+	int cycles = emu.quietCycles(remaining, steps[count - 1].cycles);
+	return (cycles / iterationCycles) * iterationCycles;
+}
+
+void IdleLoop::capture(const Emulator & emu, CpuSnapshot & snapshot)
+{
+	memcpy(snapshot.registers, emu.registers, sizeof(snapshot.registers));
+	snapshot.registers[6] = emu.computeFlags();
+	snapshot.sp = emu.reg_SP;
+	snapshot.pc = emu.reg_PC;
+}
+
+void IdleLoop::restore(Emulator & emu, const CpuSnapshot & snapshot)
+{
+	memcpy(emu.registers, snapshot.registers, sizeof(snapshot.registers));
+	emu.lazyOp = Emulator::FLAGS_READY;
+	emu.reg_SP = snapshot.sp;
+	emu.reg_PC = snapshot.pc;
+}
+
+bool IdleLoop::sameState(const CpuSnapshot & a, const CpuSnapshot & b)
+{
+	return memcmp(a.registers, b.registers, sizeof(a.registers)) == 0 && a.sp == b.sp && a.pc == b.pc;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "types.h"
+
+class Emulator;
+
+//everything an instruction in an idle loop can change, F is stored worked out (see Emulator::computeFlags)
+struct CpuSnapshot
+{
+	Byte registers[8];
+	Word sp;
+	Word pc;
+};
+
+/*Finds busy wait loops like ld a,[$ff44]; cp 144; jr nz (polling LY, STAT, the joypad or a flag in ram that the
+vblank handler sets) & skips them. A short backward jump makes the loop a candidate if every instruction in it
+only reads memory & changes registers. One iteration is then recorded (the cpu state before each instruction, the
+byte it read & its cycles). If the cpu is back in exactly the same state at the end, every iteration after it will
+do the same thing until one of the bytes it reads changes or an interrupt gets taken.
+
+Skipping just replays the recorded cpu states & lets the timers, graphics & interrupts catch up after each
+instruction, so it ends exactly where executing the loop would have. While none of the hardware is about to reach
+a point where something the loop could read changes (see Emulator::quietCycles) whole iterations get handed to it
+in one go.*/
+class IdleLoop
+{
+public:
+	IdleLoop();
+
+	//called after every instruction, once the hardware has caught up
+	void instructionDone(Emulator & emu, int cycles);
+
+	bool found() const { return state == LOOP_FOUND; }
+
+	//not in the middle of looking at a loop, so the instructions don't all have to be seen one at a time
+	bool watching() const { return state == LOOP_WATCHING; }
+
+	//the instructions up to executed ran as compiled code (see Emulator::runNative), only that one gets instructionDone
+	void resume(Address executed) { nextPC = executed; }
+
+	//skips iterations until something changes or it's past budget cycles, returns the cycles skipped
+	int skip(Emulator & emu, int budget);
+
+private:
+	static const int MAX_LOOP_OPS = 8;
+	static const int MAX_LOOP_BYTES = 16;
+
+	enum State
+	{
+		LOOP_WATCHING,
+		LOOP_RECORDING,
+		LOOP_FOUND
+	};
+
+	//which memory an instruction reads, if any
+	enum ReadKind
+	{
+		READS_NOTHING,
+		READS_HL,
+		READS_BC,
+		READS_DE,
+		READS_ADDRESS, //ld a,[nn]
+		READS_HIGH, //ldh a,[n]
+		READS_HIGH_C, //ld a,[c]
+		NOT_ALLOWED //writes memory, touches the stack, jumps somewhere else...
+	};
+
+	struct Step
+	{
+		Address pc;
+		ReadKind reads;
+		Word operand;
+		CpuSnapshot before;
+		int readAddress; //-1 if the instruction doesn't read memory
+		Byte readValue;
+		int cycles;
+	};
+
+	State state;
+	Step steps[MAX_LOOP_OPS];
+	int count;
+	int position; //the instruction that's about to run
+	Address nextPC; //where the cpu was after the last instruction, i.e. where the next one starts
+	int iterationCycles;
+
+	//the last loop that turned out not to be skippable, so it doesn't get decoded again on every iteration
+	Address rejectedStart;
+	Address rejectedJump;
+	Byte rejectedBank;
+
+	bool decode(const Emulator & emu, Address start, Address jump);
+	void record(const Emulator & emu);
+	int bulkCycles(Emulator & emu, int remaining) const;
+
+	static ReadKind classify(Byte code, Byte cbCode);
+	static void capture(const Emulator & emu, CpuSnapshot & snapshot);
+	static void restore(Emulator & emu, const CpuSnapshot & snapshot);
+	static bool sameState(const CpuSnapshot & a, const CpuSnapshot & b);
+};
@@ -0,0 +1,1521 @@
+#include "Jit.h"
+#include "BlockCache.h"
+#include <string.h>
+
+#if JIT_SUPPORTED
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+//lahf's SF ZF - AF - PF - CF turned into the gameboy's Z - H C, compiled code indexes it with ah
+static const size_t FLAG_TABLE_SIZE = 256;
+
+//the most cycles one chunk of inline instructions checks for, more means fewer checks but leaving earlier
+static const int CHUNK_CYCLES = 16;
+
+#if JIT_SUPPORTED
+namespace
+{
+	//register numbers as x86-64 encodes them, 8 bit 4-7 are ah ch dh bh unless there's a REX prefix
+	enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+	const int AH = 4, BH = 7;
+
+	/*The gameboy registers live in callee saved registers for the whole block: A & F are bh & bl, BC DE HL are
+	r12-r14 & SP is bp (the 16 bit values zero extended). r15 holds the Emulator *.*/
+	const int REG_F = RBX, REG_A = BH, REG_BC = R12, REG_DE = R13, REG_HL = R14, REG_SP = RBP, REG_EMU = R15;
+
+	//the cycles of the chunks run since the hardware last caught up, calls out don't keep it (see Translator::pending)
+	const int REG_RAN = R11;
+
+	//Linux passes the first integer arguments in rdi rsi rdx rcx, Windows in rcx rdx r8 r9
+#ifdef _WIN32
+	const int ARG0 = RCX, ARG1 = RDX, ARG2 = R8, ARG3 = R9;
+#else
+	const int ARG0 = RDI, ARG1 = RSI, ARG2 = RDX, ARG3 = RCX;
+#endif
+
+	//below the pushed registers: Windows' 32 bytes of shadow space, the quiet cycles that are left & REG_RAN over a call
+	const int FRAME_SIZE = 40;
+	const int32_t QUIET = 32, SAVED_RAN = 36;
+
+	enum Condition { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD };
+
+	//the /digit of the alu & shift groups
+	enum AluOp { ALU_ADD, ALU_OR, ALU_ADC, ALU_SBB, ALU_AND, ALU_SUB, ALU_XOR, ALU_CMP };
+	enum ShiftOp { SHIFT_ROL, SHIFT_ROR, SHIFT_RCL, SHIFT_RCR, SHIFT_SHL, SHIFT_SHR, SHIFT_SAR = 7 };
+
+	//[base + index * scale + disp], index < 0 for none
+	struct Mem
+	{
+		int base;
+		int index;
+		int scale;
+		int32_t disp;
+	};
+
+	Mem at(int base, int32_t disp)
+	{
+		Mem mem = { base, -1, 1, disp };
+		return mem;
+	}
+
+	Mem at(int base, int index, int scale, int32_t disp)
+	{
+		Mem mem = { base, index, scale, disp };
+		return mem;
+	}
+
+	/*Just enough of an x86-64 assembler for the translator. size is the operand size in bytes, 8 bit operands
+	can't mix ah-bh with anything that needs a REX prefix (r8-r15 or a 64 bit operand).*/
+	struct Emitter
+	{
+		std::vector<Byte> bytes;
+
+		size_t here() const { return bytes.size(); }
+		void byte(int value) { bytes.push_back((Byte)value); }
+
+		void immediate(int size, int32_t value)
+		{
+			for (int i = 0; i < ((size == 8) ? 4 : size); i++)
+				byte(value >> (i * 8));
+		}
+
+		void prefix(int size, int reg, int index, int base)
+		{
+			if (size == 2)
+				byte(0x66);
+
+			int rex = ((size == 8) ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0);
+			if (rex)
+				byte(0x40 | rex);
+		}
+
+		void opcode(int op)
+		{
+			if (op > 0xFF)
+				byte(op >> 8);
+			byte(op);
+		}
+
+		//op with a register (or /digit) & a register
+		void rr(int size, int op, int reg, int rm)
+		{
+			prefix(size, reg, 0, rm);
+			opcode(op);
+			byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+		}
+
+		//op with a register (or /digit) & memory
+		void rm(int size, int op, int reg, Mem mem)
+		{
+			prefix(size, reg, (mem.index >= 0) ? mem.index : 0, mem.base);
+			opcode(op);
+
+			bool sib = mem.index >= 0 || (mem.base & 7) == RSP;
+			int mod = (mem.disp == 0 && (mem.base & 7) != RBP) ? 0 : (mem.disp >= -128 && mem.disp < 128) ? 1 : 2;
+			byte((mod << 6) | ((reg & 7) << 3) | (sib ? 4 : (mem.base & 7)));
+			if (sib)
+			{
+				int scale = (mem.scale == 8) ? 3 : (mem.scale == 4) ? 2 : (mem.scale == 2) ? 1 : 0;
+				byte((scale << 6) | ((((mem.index >= 0) ? mem.index : RSP) & 7) << 3) | (mem.base & 7));
+			}
+
+			if (mod == 1)
+				byte(mem.disp);
+			else if (mod == 2)
+				immediate(4, mem.disp);
+		}
+
+		void mov(int size, int dst, int src) { rr(size, (size == 1) ? 0x88 : 0x89, src, dst); }
+		void load(int size, int dst, Mem mem) { rm(size, (size == 1) ? 0x8A : 0x8B, dst, mem); }
+		void store(int size, Mem mem, int src) { rm(size, (size == 1) ? 0x88 : 0x89, src, mem); }
+		void lea(int size, int dst, Mem mem) { rm(size, 0x8D, dst, mem); }
+		void movsxd(int dst, Mem mem) { rm(8, 0x63, dst, mem); }
+		void movzx8(int dst, int src) { rr(4, 0x0FB6, dst, src); }
+		void movzx8(int dst, Mem mem) { rm(4, 0x0FB6, dst, mem); }
+		void movzx16(int dst, int src) { rr(4, 0x0FB7, dst, src); }
+		void movzx16(int dst, Mem mem) { rm(4, 0x0FB7, dst, mem); }
+
+		void storeImm(int size, Mem mem, int32_t value)
+		{
+			rm(size, (size == 1) ? 0xC6 : 0xC7, 0, mem);
+			immediate(size, value);
+		}
+
+		//mov r32, imm32 (zero extends) & mov r8, imm8
+		void movImm(int dst, uint32_t value)
+		{
+			prefix(4, 0, 0, dst);
+			byte(0xB8 + (dst & 7));
+			immediate(4, (int32_t)value);
+		}
+
+		void movImm8(int dst, int value)
+		{
+			prefix(1, 0, 0, dst);
+			byte(0xB0 + (dst & 7));
+			byte(value);
+		}
+
+		void movImm64(int dst, uint64_t value)
+		{
+			prefix(8, 0, 0, dst);
+			byte(0xB8 + (dst & 7));
+			immediate(4, (int32_t)value);
+			immediate(4, (int32_t)(value >> 32));
+		}
+
+		void alu(int size, int op, int dst, int src) { rr(size, (op << 3) | ((size == 1) ? 0 : 1), src, dst); }
+
+		void aluImm(int size, int op, int dst, int32_t value)
+		{
+			bool small = size != 1 && value >= -128 && value < 128;
+			rr(size, (size == 1) ? 0x80 : small ? 0x83 : 0x81, op, dst);
+			immediate(small ? 1 : size, value);
+		}
+
+		void aluImm(int size, int op, Mem mem, int32_t value)
+		{
+			bool small = size != 1 && value >= -128 && value < 128;
+			rm(size, (size == 1) ? 0x80 : small ? 0x83 : 0x81, op, mem);
+			immediate(small ? 1 : size, value);
+		}
+
+		void aluStore(int size, int op, Mem mem, int src) { rm(size, (op << 3) | ((size == 1) ? 0 : 1), src, mem); }
+
+		void shift(int size, int op, int reg, int count)
+		{
+			rr(size, (count == 1) ? ((size == 1) ? 0xD0 : 0xD1) : ((size == 1) ? 0xC0 : 0xC1), op, reg);
+			if (count != 1)
+				byte(count);
+		}
+
+		void inc(int size, int reg) { rr(size, (size == 1) ? 0xFE : 0xFF, 0, reg); }
+		void dec(int size, int reg) { rr(size, (size == 1) ? 0xFE : 0xFF, 1, reg); }
+		void not8(int reg) { rr(1, 0xF6, 2, reg); }
+		void test(int size, int a, int b) { rr(size, (size == 1) ? 0x84 : 0x85, b, a); }
+
+		void testImm(int size, int reg, int32_t value)
+		{
+			rr(size, (size == 1) ? 0xF6 : 0xF7, 0, reg);
+			immediate(size, value);
+		}
+
+		void bt(int reg, int bit)
+		{
+			rr(4, 0x0FBA, 4, reg);
+			byte(bit);
+		}
+
+		void setcc(int condition, int reg) { rr(1, 0x0F90 | condition, 0, reg); }
+		void lahf() { byte(0x9F); }
+		void push(int reg) { prefix(4, 0, 0, reg); byte(0x50 + (reg & 7)); }
+		void pop(int reg) { prefix(4, 0, 0, reg); byte(0x58 + (reg & 7)); }
+		void ret() { byte(0xC3); }
+
+		void jmp(int reg)
+		{
+			prefix(4, 0, 0, reg);
+			byte(0xFF);
+			byte(0xE0 | (reg & 7));
+		}
+
+		//lea reg, [rip + target], origin is where bytes[0] ends up
+		void leaRip(int reg, const Byte * origin, const void * target)
+		{
+			prefix(8, reg, 0, 0);
+			byte(0x8D);
+			byte(0x05 | ((reg & 7) << 3));
+			immediate(4, (int32_t)((const Byte *)target - (origin + here() + 4)));
+		}
+
+		//lea reg, [rip + somewhere in bytes], pointed there with patch like a jump
+		size_t leaRip(int reg)
+		{
+			prefix(8, reg, 0, 0);
+			byte(0x8D);
+			byte(0x05 | ((reg & 7) << 3));
+			immediate(4, 0);
+			return here() - 4;
+		}
+
+		//through rax, the emulator's code can be anywhere in the address space
+		void call(uintptr_t function)
+		{
+			movImm64(RAX, function);
+			byte(0xFF);
+			byte(0xD0);
+		}
+
+		//jumps return where their rel32 is so they can be pointed somewhere with patch
+		size_t jcc(int condition)
+		{
+			byte(0x0F);
+			byte(0x80 | condition);
+			immediate(4, 0);
+			return here() - 4;
+		}
+
+		size_t jmp()
+		{
+			byte(0xE9);
+			immediate(4, 0);
+			return here() - 4;
+		}
+
+		void patch(size_t jump, size_t target)
+		{
+			int32_t rel = (int32_t)(target - (jump + 4));
+			memcpy(&bytes[jump], &rel, 4);
+		}
+	};
+
+	//where the fields compiled code touches are, relative to the Emulator *
+	struct Layout
+	{
+		int32_t bc, de, hl, af, sp, pc;
+		int32_t ime, halted, interruptPending;
+		int32_t totalCycles, graphicsSlack, graphicsPending;
+		int32_t nativeLast, nativeKey;
+		int32_t memory, readPages;
+	};
+
+	//what a compiled instruction does with the rest of the emulator
+	enum Kind
+	{
+		INLINE, //all in host code, at most a store to ram that leaves the block if it isn't plain ram
+		STORE, //a static store somewhere writeMemory has to look at, through Emulator::nativeStore
+		GENERIC //the interpreter's handler, through Emulator::nativeExecute
+	};
+
+	//whether an inline instruction only writes F, reads (or keeps part of) it, or leaves it alone
+	enum FlagUse { FLAGS_NONE, FLAGS_READ, FLAGS_WRITE };
+
+	bool ramAddress(Address address)
+	{
+		return (address >= 0xC000 && address <= 0xDFFF) || (address >= 0xFF80 && address <= 0xFFFE);
+	}
+
+	Kind kind(const MicroOp & op)
+	{
+		const int code = op.code, x = code >> 6, y = (code >> 3) & 7, z = code & 7, q = y & 1;
+
+		if (x == 1 || x == 2)
+			return INLINE;
+
+		if (x == 0)
+		{
+			if (z == 0 && (y == 1 || y == 2)) //LD (nn),SP & STOP
+				return GENERIC;
+			if ((z == 4 || z == 5) && y == 6) //INC/DEC (HL)
+				return GENERIC;
+			if (code == 0x27) //DAA
+				return GENERIC;
+			return INLINE;
+		}
+
+		switch (z)
+		{
+		case 0:
+			if (y == 4)
+				return (op.value >= 0x80 && op.value != 0xFF) ? INLINE : STORE;
+			return (y == 6) ? INLINE : GENERIC;
+		case 1:
+			return (q == 1 && y == 7) ? INLINE : GENERIC; //LD SP,HL
+		case 2:
+			if (y == 4)
+				return STORE;
+			if (y == 5)
+				return ramAddress((Address)(op.value2 << 8 | op.value)) ? INLINE : STORE;
+			return INLINE;
+		case 3:
+			if (y == 1)
+				return ((op.value & 7) != 6 || (op.value >> 6) == 1) ? INLINE : GENERIC; //CB, (HL) ones only for BIT
+			return (y == 0 || y == 6) ? INLINE : GENERIC; //JP & DI
+		case 6:
+			return INLINE;
+		default:
+			return GENERIC;
+		}
+	}
+
+	FlagUse flagUse(const MicroOp & op)
+	{
+		const int code = op.code, x = code >> 6, y = (code >> 3) & 7, z = code & 7;
+
+		if (x == 2 || (x == 3 && z == 6))
+			return (y == 1 || y == 3) ? FLAGS_READ : FLAGS_WRITE; //ADC & SBC use the carry
+		if (x == 0)
+		{
+			if ((z == 0 && y >= 4) || (z == 1 && (y & 1)) || z == 4 || z == 5) //JR cc, ADD HL & INC/DEC keep part of it
+				return FLAGS_READ;
+			if (z == 7)
+				return (y < 2) ? FLAGS_WRITE : FLAGS_READ;
+			return FLAGS_NONE;
+		}
+		if (x == 3 && z == 2 && y < 4) //JP cc
+			return FLAGS_READ;
+		if (code == 0xCB)
+		{
+			int cx = op.value >> 6, cy = (op.value >> 3) & 7;
+			if (cx == 0)
+				return (cy == 2 || cy == 3) ? FLAGS_READ : FLAGS_WRITE;
+			return (cx == 1) ? FLAGS_READ : FLAGS_NONE;
+		}
+		return FLAGS_NONE;
+	}
+
+	//whether an inline instruction can leave the block after it's done, anything left in F has to be right there
+	bool mayLeave(const MicroOp & op)
+	{
+		const int code = op.code, x = code >> 6, y = (code >> 3) & 7, z = code & 7;
+		return (x == 1 && y == 6) || (x == 0 && z == 2 && (y & 1) == 0) || (x == 0 && z == 6 && y == 6) || code == 0x76 ||
+			code == 0xE0 || code == 0xEA;
+	}
+
+	class Translator
+	{
+	public:
+		struct Fixup
+		{
+			size_t jump;
+			size_t target;
+		};
+
+		Translator(const Layout & layout, const Byte * origin, const Byte * flagTable, const bool * ramCode) :
+			layout(layout), origin(origin), flagTable(flagTable), ramCode(ramCode) {}
+
+		void block(const std::vector<MicroOp> & ops, uint32_t key);
+
+		//the hot path followed by the out of line code & the entry points' table, only valid after block
+		const std::vector<Byte> & code() const { return hot.bytes; }
+
+		//which of the block's instructions the code can be entered at
+		const std::vector<bool> & entryPoints() const { return entries; }
+
+		/*Where another block's exit can jump straight to instead of leaving, when it's going to this block's start:
+		with eax, ecx & edx set up for leaving (see block) it checks the first chunk & carries on from there.*/
+		size_t chainEntry() const { return chain; }
+
+		//the exits that go somewhere else, jump is the rel32 in code that can be pointed at the chain entry for target
+		const std::vector<Fixup> & chainExits() const { return chains; }
+
+	private:
+		Layout layout;
+		const Byte * origin;
+		const Byte * flagTable;
+		const bool * ramCode;
+
+		//straight line code & the exits/slow paths it jumps out to, cold gets put after hot
+		Emitter hot, cold;
+		std::vector<Fixup> hotToCold, coldToHot;
+		size_t leave, done; //in cold
+		size_t chain;
+		std::vector<Fixup> chains;
+
+		/*Every instruction nothing is pending at can be entered: the start of each chunk & whatever comes straight
+		after a call out. That's where the block carries on from when the hardware stopped it partway through,
+		or goes round again when it jumps back into itself.*/
+		std::vector<Address> pcs;
+		std::vector<int> chunks; //worst case cycles of the chunk starting at each instruction, 0 if one doesn't
+		std::vector<bool> entries;
+		std::vector<size_t> checks, bodies; //where each entry point's check & its first instruction are in hot
+		std::vector<Fixup> jumpsIn; //from cold to the body of the entry point at index target
+
+		Address pc; //of the instruction being translated
+		int cycles; //it takes when it doesn't jump
+		int length;
+		int pending; //cycles since the last entry point, on top of REG_RAN, known when compiling
+		int last; //pc | cycles << 16 of the last instruction run inline, -1 after a call out (it set nativeLast)
+
+		void toCold(size_t jump) { toCold(jump, cold.here()); }
+		void toCold(size_t jump, size_t target);
+		void toHot(size_t jump, size_t target);
+		void spill(Emitter & e);
+		void reload(Emitter & e);
+		void exit(int condition, int flush, Address next, int lastRun, bool chained = false);
+		void leaveFromCold(Address next, int lastRun, bool chained = false);
+		size_t entryAt(Address target) const;
+
+		void readR8(int dst, int r);
+		void writeR8(int r, int src);
+		void writeR8Imm(int r, int value);
+		void hostFlags(int keep, int take, int set);
+
+		void read();
+		void readStatic(Address address);
+		void write();
+		void writeStatic(Address address);
+		void storeSlowPath();
+
+		void inlineOp(const MicroOp & op, bool live);
+		void alu(int operation, bool immediate, int value, bool live);
+		void incDec(int r, bool decrement, bool live);
+		void addHL(int pair, bool live);
+		void bitOp(Byte code, bool live);
+		void jump(int condition, Address target, int taken);
+		void halt();
+		void store(const MicroOp & op);
+		void generic(const MicroOp & op);
+	};
+
+	void Translator::toCold(size_t jump, size_t target)
+	{
+		Fixup fixup = { jump, target };
+		hotToCold.push_back(fixup);
+	}
+
+	void Translator::toHot(size_t jump, size_t target)
+	{
+		Fixup fixup = { jump, target };
+		coldToHot.push_back(fixup);
+	}
+
+	void Translator::spill(Emitter & e)
+	{
+		e.store(2, at(REG_EMU, layout.bc), REG_BC);
+		e.store(2, at(REG_EMU, layout.de), REG_DE);
+		e.store(2, at(REG_EMU, layout.hl), REG_HL);
+		e.store(2, at(REG_EMU, layout.af), RBX);
+		e.store(2, at(REG_EMU, layout.sp), REG_SP);
+	}
+
+	void Translator::reload(Emitter & e)
+	{
+		e.movzx16(REG_BC, at(REG_EMU, layout.bc));
+		e.movzx16(REG_DE, at(REG_EMU, layout.de));
+		e.movzx16(REG_HL, at(REG_EMU, layout.hl));
+		e.movzx16(RBX, at(REG_EMU, layout.af));
+		e.movzx16(REG_SP, at(REG_EMU, layout.sp));
+	}
+
+	/*Leaves the block (always when condition is < 0) after handing over REG_RAN + flush cycles, with the PC at next.
+	A chained exit can go on to the block at next instead once that's been compiled (see chainEntry).*/
+	void Translator::exit(int condition, int flush, Address next, int lastRun, bool chained)
+	{
+		toCold((condition < 0) ? hot.jmp() : hot.jcc(condition));
+		cold.lea(4, RAX, at(REG_RAN, flush));
+		leaveFromCold(next, lastRun, chained);
+	}
+
+	void Translator::leaveFromCold(Address next, int lastRun, bool chained)
+	{
+		cold.movImm(RCX, next);
+		cold.movImm(RDX, (uint32_t)lastRun);
+		size_t jump = cold.jmp();
+		cold.patch(jump, leave);
+		if (chained)
+		{
+			Fixup exit = { jump, next };
+			chains.push_back(exit);
+		}
+	}
+
+	//the index of the entry point at target, or the number of instructions when it isn't one
+	size_t Translator::entryAt(Address target) const
+	{
+		for (size_t i = 0; i < pcs.size(); i++)
+		{
+			if (pcs[i] == target)
+				return entries[i] ? i : pcs.size();
+		}
+		return pcs.size();
+	}
+
+	//C E L are the low bytes of the pairs, B D H need shifting
+	void Translator::readR8(int dst, int r)
+	{
+		int pair = R12 + (r >> 1);
+		if (r == 7)
+			hot.movzx8(dst, REG_A);
+		else if (r & 1)
+			hot.movzx8(dst, pair);
+		else
+		{
+			hot.mov(4, dst, pair);
+			hot.shift(4, SHIFT_SHR, dst, 8);
+		}
+	}
+
+	//src is one of al cl dl & gets clobbered
+	void Translator::writeR8(int r, int src)
+	{
+		int pair = R12 + (r >> 1);
+		if (r == 7)
+			hot.mov(1, REG_A, src);
+		else if (r & 1)
+			hot.mov(1, pair, src);
+		else
+		{
+			hot.movzx8(src, src);
+			hot.shift(4, SHIFT_SHL, src, 8);
+			hot.movzx8(pair, pair);
+			hot.alu(4, ALU_OR, pair, src);
+		}
+	}
+
+	void Translator::writeR8Imm(int r, int value)
+	{
+		int pair = R12 + (r >> 1);
+		if (r == 7)
+			hot.movImm8(REG_A, value);
+		else if (r & 1)
+			hot.movImm8(pair, value);
+		else
+		{
+			hot.aluImm(4, ALU_AND, pair, 0xFF);
+			hot.aluImm(4, ALU_OR, pair, value << 8);
+		}
+	}
+
+	//F = (F & keep) | (the host's Z H C & take) | set, straight after the instruction that set them
+	void Translator::hostFlags(int keep, int take, int set)
+	{
+		hot.lahf();
+		hot.movzx8(RCX, AH);
+		hot.leaRip(RDX, origin, flagTable);
+		hot.movzx8(RCX, at(RDX, RCX, 1, 0));
+		if (take != 0xB0)
+			hot.aluImm(4, ALU_AND, RCX, take);
+		if (set)
+			hot.aluImm(4, ALU_OR, RCX, set);
+
+		if (keep)
+		{
+			hot.aluImm(1, ALU_AND, REG_F, keep);
+			hot.alu(1, ALU_OR, REG_F, RCX);
+		}
+		else
+			hot.mov(1, REG_F, RCX);
+	}
+
+	/*Reads the byte at the address in ecx into eax. Everything below 0xF000 comes straight out of readPages,
+	oam, io & high ram out of memory, echo ram & the joypad go through readMemory. An oam dma never runs while
+	compiled code does (see Emulator::nativeQuiet).*/
+	void Translator::read()
+	{
+		hot.aluImm(4, ALU_CMP, RCX, 0xF000);
+		toCold(hot.jcc(CC_AE));
+		hot.mov(4, RAX, RCX);
+		hot.shift(4, SHIFT_SHR, RAX, 12);
+		hot.load(8, RDX, at(REG_EMU, RAX, 8, layout.readPages));
+		hot.aluImm(4, ALU_AND, RCX, 0xFFF);
+		hot.movzx8(RAX, at(RDX, RCX, 1, 0));
+		size_t back = hot.here();
+
+		cold.aluImm(4, ALU_CMP, RCX, 0xFE00);
+		size_t echo = cold.jcc(CC_B);
+		cold.aluImm(4, ALU_CMP, RCX, 0xFF00);
+		size_t joypad = cold.jcc(CC_E);
+		cold.movzx8(RAX, at(REG_EMU, RCX, 1, layout.memory));
+		toHot(cold.jmp(), back);
+
+		cold.patch(echo, cold.here());
+		cold.patch(joypad, cold.here());
+		cold.store(4, at(RSP, SAVED_RAN), REG_RAN);
+		cold.mov(4, ARG1, RCX);
+		cold.mov(8, ARG0, REG_EMU);
+		cold.call((uintptr_t)&Emulator::nativeRead);
+		cold.movzx8(RAX, RAX);
+		cold.load(4, REG_RAN, at(RSP, SAVED_RAN));
+		toHot(cold.jmp(), back);
+	}
+
+	void Translator::readStatic(Address address)
+	{
+		if (address < 0xF000)
+		{
+			hot.load(8, RDX, at(REG_EMU, layout.readPages + (address >> 12) * 8));
+			hot.movzx8(RAX, at(RDX, address & 0xFFF));
+		}
+		else if (address >= 0xFE00 && address != 0xFF00)
+			hot.movzx8(RAX, at(REG_EMU, layout.memory + address));
+		else
+		{
+			hot.store(4, at(RSP, SAVED_RAN), REG_RAN);
+			hot.movImm(ARG1, address);
+			hot.mov(8, ARG0, REG_EMU);
+			hot.call((uintptr_t)&Emulator::nativeRead);
+			hot.movzx8(RAX, RAX);
+			hot.load(4, REG_RAN, at(RSP, SAVED_RAN));
+		}
+	}
+
+	/*Writes al to the address in ecx. Only work & high ram that no cached block covers gets stored inline,
+	everything else is written by writeMemory & leaves the block (it's rare & whatever it did has to be looked at).*/
+	void Translator::write()
+	{
+		hot.rm(4, 0x8D, RDX, at(RCX, -0xC000)); //lea
+		hot.aluImm(4, ALU_CMP, RDX, 0x2000);
+		size_t workRam = hot.jcc(CC_B);
+		size_t slow = cold.here();
+		storeSlowPath();
+		hot.aluImm(4, ALU_CMP, RCX, 0xFF80);
+		toCold(hot.jcc(CC_B), slow);
+		hot.aluImm(4, ALU_CMP, RCX, 0xFFFF);
+		toCold(hot.jcc(CC_E), slow);
+
+		hot.patch(workRam, hot.here());
+		hot.movImm64(RDX, (uintptr_t)ramCode - 0xC000);
+		hot.aluImm(1, ALU_CMP, at(RDX, RCX, 1, 0), 0);
+		toCold(hot.jcc(CC_NE), slow);
+		hot.store(1, at(REG_EMU, RCX, 1, layout.memory), RAX);
+	}
+
+	//the address is known to be plain ram
+	void Translator::writeStatic(Address address)
+	{
+		hot.movImm64(RDX, (uintptr_t)&ramCode[address - 0xC000]);
+		hot.aluImm(1, ALU_CMP, at(RDX, 0), 0);
+		toCold(hot.jcc(CC_NE));
+		cold.movImm(RCX, address);
+		storeSlowPath();
+		hot.store(1, at(REG_EMU, layout.memory + address), RAX);
+	}
+
+	//address in ecx & value in al, writeMemory does the store & the block is left whatever it did
+	void Translator::storeSlowPath()
+	{
+		spill(cold);
+		cold.movzx8(R10, RAX);
+		cold.shift(4, SHIFT_SHL, R10, 16);
+		cold.alu(4, ALU_OR, R10, RCX);
+		cold.aluImm(4, ALU_OR, R10, length << 24);
+		cold.mov(4, ARG1, R10);
+		cold.mov(8, ARG0, REG_EMU);
+		cold.movImm(ARG2, pc);
+		cold.lea(4, ARG3, at(REG_RAN, pending));
+		cold.aluImm(4, ALU_OR, ARG3, cycles << 16);
+		cold.call((uintptr_t)&Emulator::nativeStore);
+		cold.patch(cold.jmp(), done);
+	}
+
+	void Translator::alu(int operation, bool immediate, int value, bool live)
+	{
+		static const int hostOps[8] = { ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBB, ALU_AND, ALU_XOR, ALU_OR, ALU_CMP };
+
+		if (operation == 7 && !live)
+			return;
+		if (operation == 1 || operation == 3)
+			hot.bt(REG_F, 4);
+
+		if (immediate)
+			hot.aluImm(1, hostOps[operation], REG_A, value);
+		else
+			hot.alu(1, hostOps[operation], REG_A, RAX);
+
+		if (!live)
+			return;
+		if (operation < 2)
+			hostFlags(0, 0xB0, 0);
+		else if (operation < 4 || operation == 7)
+			hostFlags(0, 0xB0, 0x40);
+		else if (operation == 4)
+			hostFlags(0, 0x80, 0x20);
+		else
+			hostFlags(0, 0x80, 0);
+	}
+
+	//inc & dec set Z & H like the gameboy's, the carry is kept
+	void Translator::incDec(int r, bool decrement, bool live)
+	{
+		int reg = (r == 7) ? REG_A : (r & 1) ? R12 + (r >> 1) : RAX;
+		if (reg == RAX)
+			readR8(RAX, r);
+
+		if (decrement)
+			hot.dec(1, reg);
+		else
+			hot.inc(1, reg);
+
+		if (live)
+			hostFlags(0x10, 0xA0, decrement ? 0x40 : 0);
+		if (reg == RAX)
+			writeR8(r, RAX);
+	}
+
+	//H is the carry out of bit 11 & C out of bit 15, Z is kept
+	void Translator::addHL(int pair, bool live)
+	{
+		if (live)
+		{
+			hot.mov(4, RDX, REG_HL);
+			hot.aluImm(4, ALU_AND, RDX, 0xFFF);
+			hot.mov(4, RAX, pair);
+			hot.aluImm(4, ALU_AND, RAX, 0xFFF);
+			hot.alu(4, ALU_ADD, RDX, RAX);
+		}
+
+		hot.mov(4, RAX, REG_HL);
+		hot.alu(4, ALU_ADD, RAX, pair);
+
+		if (live)
+		{
+			hot.shift(4, SHIFT_SHR, RDX, 7);
+			hot.aluImm(4, ALU_AND, RDX, 0x20);
+			hot.mov(4, RCX, RAX);
+			hot.shift(4, SHIFT_SHR, RCX, 12);
+			hot.aluImm(4, ALU_AND, RCX, 0x10);
+			hot.aluImm(1, ALU_AND, REG_F, 0x80);
+			hot.alu(1, ALU_OR, REG_F, RDX);
+			hot.alu(1, ALU_OR, REG_F, RCX);
+		}
+
+		hot.movzx16(REG_HL, RAX);
+	}
+
+	//the CB prefixed instructions, (HL) only for BIT
+	void Translator::bitOp(Byte code, bool live)
+	{
+		static const int shifts[8] = { SHIFT_ROL, SHIFT_ROR, SHIFT_RCL, SHIFT_RCR, SHIFT_SHL, SHIFT_SAR, SHIFT_ROL, SHIFT_SHR };
+		const int x = code >> 6, y = (code >> 3) & 7, z = code & 7;
+		const int mask = 1 << y;
+		const int pair = R12 + (z >> 1);
+
+		if (x == 0)
+		{
+			readR8(RAX, z);
+			if (y == 2 || y == 3)
+				hot.bt(REG_F, 4);
+			hot.shift(1, shifts[y], RAX, (y == 6) ? 4 : 1);
+
+			//Z & C, SWAP always clears C
+			if (live)
+			{
+				if (y == 6)
+					hot.movImm8(RCX, 0);
+				else
+				{
+					hot.setcc(CC_B, RCX);
+					hot.shift(1, SHIFT_SHL, RCX, 4);
+				}
+				hot.test(1, RAX, RAX);
+				hot.setcc(CC_E, RDX);
+				hot.shift(1, SHIFT_SHL, RDX, 7);
+				hot.alu(1, ALU_OR, RCX, RDX);
+				hot.mov(1, REG_F, RCX);
+			}
+			writeR8(z, RAX);
+			return;
+		}
+
+		if (x == 1)
+		{
+			if (!live)
+				return;
+
+			if (z == 6)
+			{
+				hot.mov(4, RCX, REG_HL);
+				read();
+				hot.testImm(1, RAX, mask);
+			}
+			else if (z == 7)
+				hot.testImm(1, REG_A, mask);
+			else if (z & 1)
+				hot.testImm(1, pair, mask);
+			else
+				hot.testImm(4, pair, mask << 8);
+
+			//H set, N cleared, C kept
+			hot.setcc(CC_E, RCX);
+			hot.shift(1, SHIFT_SHL, RCX, 7);
+			hot.aluImm(1, ALU_AND, REG_F, 0x10);
+			hot.aluImm(1, ALU_OR, REG_F, 0x20);
+			hot.alu(1, ALU_OR, REG_F, RCX);
+			return;
+		}
+
+		//RES & SET
+		int op = (x == 2) ? ALU_AND : ALU_OR;
+		if (z == 7)
+			hot.aluImm(1, op, REG_A, (x == 2) ? ~mask : mask);
+		else if (z & 1)
+			hot.aluImm(1, op, pair, (x == 2) ? ~mask : mask);
+		else
+			hot.aluImm(4, op, pair, (x == 2) ? ~(mask << 8) : (mask << 8));
+	}
+
+	/*condition is the cc field (NZ Z NC C) or < 0 for an unconditional jump. A jump to one of the block's own entry
+	points goes straight there (after that chunk's check, which leaves with the jump as the last instruction run).*/
+	void Translator::jump(int condition, Address target, int taken)
+	{
+		int lastRun = pc | taken << 16;
+		int hostCondition = (condition < 0) ? -1 : (condition & 1) ? CC_NE : CC_E;
+		if (condition >= 0)
+			hot.testImm(1, REG_F, (condition < 2) ? 0x80 : 0x10);
+
+		size_t into = entryAt(target);
+		if (into == pcs.size())
+		{
+			exit(hostCondition, pending + taken, target, lastRun, true);
+			return;
+		}
+
+		toCold((condition < 0) ? hot.jmp() : hot.jcc(hostCondition));
+		cold.aluImm(4, ALU_ADD, REG_RAN, pending + taken);
+		if (chunks[into] > 0)
+		{
+			cold.aluImm(4, ALU_SUB, at(RSP, QUIET), chunks[into]);
+			Fixup in = { cold.jcc(CC_GE), into };
+			jumpsIn.push_back(in);
+			cold.mov(4, RAX, REG_RAN);
+			leaveFromCold(target, lastRun);
+		}
+		else
+		{
+			Fixup in = { cold.jmp(), into };
+			jumpsIn.push_back(in);
+		}
+	}
+
+	/*The interpreter runs HALT again every 4 cycles until an interrupt wakes the cpu up, which can't happen while the
+	hardware is quiet. So it stays on the HALT for all the quiet cycles it can in one go. If IE & IF are already
+	set handleInterrupts wakes it straight away (there's nothing it could service, see Emulator::nativeQuiet), so
+	then it's a 4 cycle NOP.*/
+	void Translator::halt()
+	{
+		hot.aluImm(1, ALU_CMP, at(REG_EMU, layout.interruptPending), 0);
+		exit(CC_NE, pending + cycles, (Address)(pc + 1), pc | cycles << 16, true);
+
+		hot.storeImm(1, at(REG_EMU, layout.halted), 1);
+		hot.load(4, RAX, at(RSP, QUIET));
+		hot.aluImm(4, ALU_AND, RAX, ~3);
+		hot.lea(4, RAX, at(RAX, REG_RAN, 1, pending + cycles));
+		toCold(hot.jmp());
+		leaveFromCold(pc, pc | cycles << 16);
+	}
+
+	void Translator::inlineOp(const MicroOp & op, bool live)
+	{
+		const int code = op.code, x = code >> 6, y = (code >> 3) & 7, z = code & 7, p = y >> 1, q = y & 1;
+		const Address next = (Address)(pc + op.length);
+		const Address immediate = (Address)(op.value2 << 8 | op.value);
+		const int pairs[4] = { REG_BC, REG_DE, REG_HL, REG_SP };
+
+		if (x == 1) //LD r,r
+		{
+			if (code == 0x76)
+				halt();
+			else if (y == 6)
+			{
+				readR8(RAX, z);
+				hot.mov(4, RCX, REG_HL);
+				write();
+			}
+			else if (z == 6)
+			{
+				hot.mov(4, RCX, REG_HL);
+				read();
+				writeR8(y, RAX);
+			}
+			else if (y != z)
+			{
+				readR8(RAX, z);
+				writeR8(y, RAX);
+			}
+			return;
+		}
+
+		if (x == 2) //alu A,r
+		{
+			if (z == 6)
+			{
+				hot.mov(4, RCX, REG_HL);
+				read();
+			}
+			else
+				readR8(RAX, z);
+			alu(y, false, 0, live);
+			return;
+		}
+
+		if (x == 0)
+		{
+			switch (z)
+			{
+			case 0: //NOP & JR
+				if (y >= 3)
+					jump((y == 3) ? -1 : y - 4, (Address)(next + (Byte_Signed)op.value), emulator_opcode_cycles(op.code, 0, true));
+				break;
+
+			case 1:
+				if (q == 0)
+					hot.movImm(pairs[p], immediate);
+				else
+					addHL(pairs[p], live);
+				break;
+
+			case 2: //(BC) (DE) (HL+) (HL-)
+				hot.mov(4, RCX, pairs[(p < 2) ? p : 2]);
+				if (p == 2)
+					hot.inc(2, REG_HL);
+				else if (p == 3)
+					hot.dec(2, REG_HL);
+
+				if (q == 0)
+				{
+					hot.movzx8(RAX, REG_A);
+					write();
+				}
+				else
+				{
+					read();
+					hot.mov(1, REG_A, RAX);
+				}
+				break;
+
+			case 3:
+				if (q == 0)
+					hot.inc(2, pairs[p]);
+				else
+					hot.dec(2, pairs[p]);
+				break;
+
+			case 4: case 5:
+				incDec(y, z == 5, live);
+				break;
+
+			case 6:
+				if (y == 6)
+				{
+					hot.mov(4, RCX, REG_HL);
+					hot.movImm(RAX, op.value);
+					write();
+				}
+				else
+					writeR8Imm(y, op.value);
+				break;
+
+			case 7:
+				switch (y)
+				{
+				case 0: case 1: case 2: case 3: //RLCA RRCA RLA RRA, F is just the carry
+					if (y >= 2)
+						hot.bt(REG_F, 4);
+					hot.shift(1, (y == 0) ? SHIFT_ROL : (y == 1) ? SHIFT_ROR : (y == 2) ? SHIFT_RCL : SHIFT_RCR, REG_A, 1);
+					if (live)
+					{
+						hot.setcc(CC_B, REG_F);
+						hot.shift(1, SHIFT_SHL, REG_F, 4);
+					}
+					break;
+				case 5: //CPL
+					hot.not8(REG_A);
+					if (live)
+						hot.aluImm(1, ALU_OR, REG_F, 0x60);
+					break;
+				case 6: //SCF
+					if (live)
+					{
+						hot.aluImm(1, ALU_AND, REG_F, 0x80);
+						hot.aluImm(1, ALU_OR, REG_F, 0x10);
+					}
+					break;
+				case 7: //CCF
+					if (live)
+					{
+						hot.aluImm(1, ALU_AND, REG_F, 0x90);
+						hot.aluImm(1, ALU_XOR, REG_F, 0x10);
+					}
+					break;
+				}
+				break;
+			}
+			return;
+		}
+
+		switch (z)
+		{
+		case 0:
+			if (y == 4) //LDH (n),A into high ram
+			{
+				hot.movzx8(RAX, REG_A);
+				writeStatic((Address)(0xFF00 + op.value));
+			}
+			else //LDH A,(n)
+			{
+				readStatic((Address)(0xFF00 + op.value));
+				hot.mov(1, REG_A, RAX);
+			}
+			break;
+
+		case 1: //LD SP,HL
+			hot.mov(4, REG_SP, REG_HL);
+			break;
+
+		case 2:
+			if (y < 4)
+				jump(y, immediate, emulator_opcode_cycles(op.code, 0, true));
+			else if (y == 5) //LD (nn),A into ram
+			{
+				hot.movzx8(RAX, REG_A);
+				writeStatic(immediate);
+			}
+			else
+			{
+				if (y == 6) //LD A,(C)
+				{
+					hot.movzx8(RCX, REG_BC);
+					hot.aluImm(4, ALU_OR, RCX, 0xFF00);
+					read();
+				}
+				else
+					readStatic(immediate);
+				hot.mov(1, REG_A, RAX);
+			}
+			break;
+
+		case 3:
+			if (y == 0)
+				jump(-1, immediate, cycles);
+			else if (y == 1)
+				bitOp(op.value, live);
+			else //DI
+				hot.storeImm(1, at(REG_EMU, layout.ime), 0);
+			break;
+
+		case 6:
+			alu(y, true, op.value, live);
+			break;
+		}
+	}
+
+	//LDH (n),A LD (C),A & LD (nn),A somewhere that isn't plain ram, carries on if nothing came of it
+	void Translator::store(const MicroOp & op)
+	{
+		spill(hot);
+		hot.movzx8(RAX, REG_A);
+		hot.shift(4, SHIFT_SHL, RAX, 16);
+		if (op.code == 0xE2)
+		{
+			hot.movzx8(RCX, REG_BC);
+			hot.alu(4, ALU_OR, RAX, RCX);
+			hot.aluImm(4, ALU_OR, RAX, 0xFF00 | length << 24);
+		}
+		else
+			hot.aluImm(4, ALU_OR, RAX, ((op.code == 0xE0) ? 0xFF00 + op.value : op.value2 << 8 | op.value) | length << 24);
+		hot.mov(4, ARG1, RAX);
+		hot.mov(8, ARG0, REG_EMU);
+		hot.movImm(ARG2, pc);
+		hot.lea(4, ARG3, at(REG_RAN, pending));
+		hot.aluImm(4, ALU_OR, ARG3, cycles << 16);
+		hot.call((uintptr_t)&Emulator::nativeStore);
+
+		hot.test(4, RAX, RAX);
+		toCold(hot.jcc(CC_L));
+		cold.patch(cold.jmp(), done);
+		hot.store(4, at(RSP, QUIET), RAX);
+		hot.alu(4, ALU_XOR, REG_RAN, REG_RAN);
+	}
+
+	//the interpreter's handler with the hardware caught up after it, the registers go through the emulator
+	void Translator::generic(const MicroOp & op)
+	{
+		spill(hot);
+		hot.mov(8, ARG0, REG_EMU);
+		hot.movImm(ARG1, op.code | op.value << 8 | op.value2 << 16 | op.length << 24);
+		hot.movImm(ARG2, pc);
+		hot.lea(4, ARG3, at(REG_RAN, pending));
+		hot.call((uintptr_t)&Emulator::nativeExecute);
+
+		hot.test(4, RAX, RAX);
+		toCold(hot.jcc(CC_L));
+		cold.patch(cold.jmp(), done);
+		hot.store(4, at(RSP, QUIET), RAX);
+		hot.alu(4, ALU_XOR, REG_RAN, REG_RAN);
+		reload(hot);
+	}
+
+	void Translator::block(const std::vector<MicroOp> & ops, uint32_t key)
+	{
+		const size_t count = ops.size();
+		const Address start = (Address)key;
+
+		//the chunks: each run of inline instructions, split so none checks for more than CHUNK_CYCLES
+		std::vector<Kind> kinds(count);
+		chunks.assign(count, 0);
+		pcs.resize(count);
+		int open = -1;
+		for (size_t i = 0; i < count; i++)
+		{
+			pcs[i] = (i == 0) ? start : (Address)(pcs[i - 1] + ops[i - 1].length);
+			kinds[i] = kind(ops[i]);
+			if (kinds[i] != INLINE)
+			{
+				open = -1;
+				continue;
+			}
+
+			int worst = emulator_opcode_cycles(ops[i].code, ops[i].value, true);
+			if (open < 0 || chunks[open] + worst > CHUNK_CYCLES)
+				open = (int)i;
+			chunks[open] += worst;
+		}
+
+		entries.resize(count);
+		for (size_t i = 0; i < count; i++)
+			entries[i] = i == 0 || chunks[i] > 0 || kinds[i - 1] != INLINE;
+
+		//whether what an instruction leaves in F gets used before something overwrites it
+		std::vector<bool> live(count);
+		bool needed = true;
+		for (size_t i = count; i-- > 0;)
+		{
+			live[i] = needed;
+			FlagUse use = flagUse(ops[i]);
+			if (kinds[i] != INLINE || mayLeave(ops[i]) || use == FLAGS_READ)
+				needed = true;
+			else if (use == FLAGS_WRITE)
+				needed = false;
+			if (chunks[i] > 0)
+				needed = true;
+		}
+
+		/*out of line: leave with eax cycles to hand over, the next PC in ecx & nativeLast in edx. It's only set when
+		there are cycles, none means nothing ran since the block was entered or since a call out (which set it).*/
+		leave = cold.here();
+		cold.aluStore(8, ALU_ADD, at(REG_EMU, layout.totalCycles), RAX);
+		cold.aluStore(4, ALU_SUB, at(REG_EMU, layout.graphicsSlack), RAX);
+		cold.aluStore(4, ALU_ADD, at(REG_EMU, layout.graphicsPending), RAX);
+		cold.store(2, at(REG_EMU, layout.pc), RCX);
+		cold.test(4, RAX, RAX);
+		size_t skip = cold.jcc(CC_E);
+		cold.store(4, at(REG_EMU, layout.nativeLast), RDX);
+		cold.patch(skip, cold.here());
+		spill(cold);
+		done = cold.here();
+		cold.storeImm(4, at(REG_EMU, layout.nativeKey), (int32_t)key);
+		cold.aluImm(8, ALU_ADD, RSP, FRAME_SIZE);
+		cold.pop(R15);
+		cold.pop(R14);
+		cold.pop(R13);
+		cold.pop(R12);
+		cold.pop(RBP);
+		cold.pop(RBX);
+		cold.ret();
+
+		//then on to the entry point the third argument picked out of the table at the end
+		hot.push(RBX);
+		hot.push(RBP);
+		hot.push(R12);
+		hot.push(R13);
+		hot.push(R14);
+		hot.push(R15);
+		hot.aluImm(8, ALU_SUB, RSP, FRAME_SIZE);
+		hot.mov(8, REG_EMU, ARG0);
+		hot.store(4, at(RSP, QUIET), ARG1);
+		reload(hot);
+		hot.alu(4, ALU_XOR, REG_RAN, REG_RAN);
+		hot.mov(4, ARG2, ARG2);
+		size_t table = hot.leaRip(RAX);
+		hot.movsxd(RDX, at(RAX, ARG2, 4, 0));
+		hot.alu(8, ALU_ADD, RAX, RDX);
+		hot.jmp(RAX);
+
+		checks.assign(count, 0);
+		bodies.assign(count, 0);
+		pending = 0;
+		last = -1;
+		bool left = false;
+		for (size_t i = 0; i < count; i++)
+		{
+			const MicroOp & op = ops[i];
+			pc = pcs[i];
+			length = op.length;
+			cycles = emulator_opcode_cycles(op.code, op.value, false);
+
+			if (entries[i] && pending > 0)
+			{
+				hot.aluImm(4, ALU_ADD, REG_RAN, pending);
+				pending = 0;
+			}
+
+			checks[i] = hot.here();
+			if (chunks[i] > 0)
+			{
+				hot.aluImm(4, ALU_SUB, at(RSP, QUIET), chunks[i]);
+				exit(CC_L, 0, pc, last);
+			}
+			bodies[i] = hot.here();
+
+			if (kinds[i] == INLINE)
+			{
+				inlineOp(op, live[i]);
+				pending += cycles;
+				last = pc | cycles << 16;
+			}
+			else
+			{
+				if (kinds[i] == STORE)
+					store(op);
+				else
+					generic(op);
+				pending = 0;
+				last = -1;
+			}
+
+			//JR, JP & HALT end the block, everything else that does has already left
+			left = op.code == 0x18 || op.code == 0xC3 || op.code == 0x76;
+		}
+
+		if (!left)
+			exit(-1, pending, (count > 0) ? (Address)(pc + length) : start, last, true);
+
+		chain = cold.here();
+		if (count > 0 && chunks[0] > 0)
+		{
+			cold.aluImm(4, ALU_SUB, at(RSP, QUIET), chunks[0]);
+			cold.patch(cold.jcc(CC_L), leave);
+		}
+		cold.mov(4, REG_RAN, RAX);
+		Fixup first = { cold.jmp(), 0 };
+		jumpsIn.push_back(first);
+
+		//cold goes after hot
+		size_t coldStart = hot.here();
+		for (const Fixup & fixup : hotToCold)
+			hot.patch(fixup.jump, coldStart + fixup.target);
+		for (const Fixup & fixup : coldToHot)
+			cold.patch(fixup.jump, fixup.target - coldStart);
+		for (const Fixup & fixup : jumpsIn)
+			cold.patch(fixup.jump, bodies[fixup.target] - coldStart);
+		hot.bytes.insert(hot.bytes.end(), cold.bytes.begin(), cold.bytes.end());
+		chain += coldStart;
+		for (Fixup & exit : chains)
+			exit.jump += coldStart;
+
+		//the entry points' table, offsets from the table to each one's check (anything else just returns)
+		while (hot.here() & 3)
+			hot.byte(0xCC);
+		size_t tableStart = hot.here();
+		hot.patch(table, tableStart);
+		for (size_t i = 0; i < count; i++)
+			hot.immediate(4, (int32_t)(entries[i] ? checks[i] : coldStart + done) - (int32_t)tableStart);
+	}
+}
+#endif
+
+JitArena::JitArena(size_t size) : code(NULL), size(size), used(FLAG_TABLE_SIZE)
+{
+#if JIT_SUPPORTED
+#ifdef _WIN32
+	code = (Byte *)VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	void * mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	code = (mapped == MAP_FAILED) ? NULL : (Byte *)mapped;
+#endif
+
+	if (code != NULL)
+	{
+		for (size_t host = 0; host < FLAG_TABLE_SIZE; host++)
+			code[host] = ((host & 0x40) ? 0x80 : 0) | ((host & 0x10) ? 0x20 : 0) | ((host & 0x01) ? 0x10 : 0);
+	}
+
+	//e.g. the host doesn't allow pages to be made executable at all
+	if (code != NULL && !protect(true))
+	{
+		release();
+		code = NULL;
+	}
+#endif
+}
+
+JitArena::~JitArena()
+{
+	if (code != NULL)
+		release();
+}
+
+void JitArena::reset()
+{
+	used = FLAG_TABLE_SIZE;
+	chainEntries.clear();
+	unlinked.clear();
+	if (code != NULL)
+		protect(false);
+}
+
+void JitArena::release()
+{
+#if JIT_SUPPORTED
+#ifdef _WIN32
+	VirtualFree(code, 0, MEM_RELEASE);
+#else
+	munmap(code, size);
+#endif
+#endif
+}
+
+//points the rel32 of the jump at jump (both offsets into the arena) at target
+void JitArena::link(size_t jump, size_t target)
+{
+	int32_t rel = (int32_t)(target - (jump + 4));
+	memcpy(code + jump, &rel, 4);
+}
+
+//the whole arena is either writable or executable, never both
+bool JitArena::protect(bool executable)
+{
+#if JIT_SUPPORTED
+#ifdef _WIN32
+	DWORD previous;
+	return VirtualProtect(code, size, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &previous) != 0;
+#else
+	return mprotect(code, size, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#endif
+#else
+	return false;
+#endif
+}
+
+/*The block cache key of the block a jump to target from the block at key lands in, if it's one that'll stay put: 
+rom (ram blocks can be thrown away) in bank 0 or the block's own bank, which can't be switched while it runs.*/
+static bool chainKey(uint32_t key, Address target, uint32_t & targetKey)
+{
+	Address start = (Address)key;
+	if (target < 0x4000)
+		targetKey = target;
+	else if (target < 0x8000 && start >= 0x4000 && start < 0x8000)
+		targetKey = (key & 0xFFFF0000) | target;
+	else
+		return false;
+	return true;
+}
+
+JitFunction JitArena::compile(const Emulator & emu, const std::vector<MicroOp> & ops, uint32_t key, std::vector<bool> & entryPoints)
+{
+#if JIT_SUPPORTED
+	if (code == NULL)
+		return NULL;
+
+	const Byte * base = (const Byte *)&emu;
+	Layout layout;
+	layout.bc = (int32_t)((const Byte *)&emu.reg_BC - base);
+	layout.de = (int32_t)((const Byte *)&emu.reg_DE - base);
+	layout.hl = (int32_t)((const Byte *)&emu.reg_HL - base);
+	layout.af = (int32_t)((const Byte *)&emu.reg_AF - base);
+	layout.sp = (int32_t)((const Byte *)&emu.reg_SP - base);
+	layout.pc = (int32_t)((const Byte *)&emu.reg_PC - base);
+	layout.ime = (int32_t)((const Byte *)&emu.interruptMasterEnable - base);
+	layout.halted = (int32_t)((const Byte *)&emu.halted - base);
+	layout.interruptPending = (int32_t)((const Byte *)&emu.interruptPending - base);
+	layout.totalCycles = (int32_t)((const Byte *)&emu.totalCycles - base);
+	layout.graphicsSlack = (int32_t)((const Byte *)&emu.graphicsSlack - base);
+	layout.graphicsPending = (int32_t)((const Byte *)&emu.graphicsPending - base);
+	layout.nativeLast = (int32_t)((const Byte *)&emu.nativeLast - base);
+	layout.nativeKey = (int32_t)((const Byte *)&emu.nativeKey - base);
+	layout.memory = (int32_t)((const Byte *)emu.memory - base);
+	layout.readPages = (int32_t)((const Byte *)emu.readPages - base);
+
+	//blocks start on 16 bytes, the code is put together first since rip relative operands need to know where it goes
+	size_t offset = (used + 15) & ~(size_t)15;
+	Translator translator(layout, code + offset, code, emu.blockCache->ramCodeMap());
+	translator.block(ops, key);
+	const std::vector<Byte> & bytes = translator.code();
+
+	if (offset + bytes.size() > size || !protect(false))
+		return NULL;
+
+	memcpy(code + offset, bytes.data(), bytes.size());
+	used = offset + bytes.size();
+
+	//exits to blocks that are already compiled go straight there, the rest once they are
+	for (const Translator::Fixup & exit : translator.chainExits())
+	{
+		uint32_t target;
+		if (!chainKey(key, (Address)exit.target, target))
+			continue;
+
+		auto found = chainEntries.find(target);
+		if (found != chainEntries.end())
+			link(offset + exit.jump, found->second);
+		else
+			unlinked.insert(std::make_pair(target, offset + exit.jump));
+	}
+
+	if ((Address)key < 0x8000)
+	{
+		size_t entry = offset + translator.chainEntry();
+		chainEntries[key] = entry;
+		auto waiting = unlinked.equal_range(key);
+		for (auto exit = waiting.first; exit != waiting.second; ++exit)
+			link(exit->second, entry);
+		unlinked.erase(key);
+	}
+
+	if (!protect(true))
+		return NULL;
+
+	entryPoints = translator.entryPoints();
+	return (JitFunction)(code + offset);
+#else
+	return NULL;
+#endif
+}
+
+/*How many cycles compiled code can hand straight to totalCycles & the graphics' pending cycles, the same as catchUp
+doing it after each instruction: none of the timers, the lcd or the interrupts would have done anything in that
+time. < 0 when not even that is true (an interrupt is about to be serviced or an oam dma is running), compiled code
+never runs an instruction inline that would go past it or past the run loop's budget.*/
+int Emulator::nativeQuiet() const
+{
+	if (interruptPending && (halted || (interruptMasterEnable && (memory[0xFF0F] & memory[0xFFFF] & 0x1F) != 0)))
+		return -1;
+	if (totalCycles < dmaEndsAt || totalCycles >= nextTimerEvent)
+		return -1;
+
+	int quiet = nativeBudget - (int)(totalCycles - nativeStart);
+	if (graphicsSlack < quiet)
+		quiet = graphicsSlack;
+	if (quiet > 0 && nextTimerEvent - totalCycles - 1 < (uint64_t)quiet)
+		quiet = (int)(nextTimerEvent - totalCycles - 1);
+	return quiet;
+}
+
+//what catchUp does with the cycles while nothing is due (see nativeQuiet)
+void Emulator::nativeFlush(int cycles)
+{
+	totalCycles += cycles;
+	graphicsSlack -= cycles;
+	graphicsPending += cycles;
+}
+
+//after the instruction at pc was run by the emulator for compiled code: the hardware catches up for real
+int Emulator::nativeSynced(Address pc, int length, int cycles)
+{
+	num_cycles = cycles;
+	catchUp<ScanlinePpu>(cycles);
+	flags();
+	nativeLast = pc | cycles << 16;
+
+	//it jumped, an interrupt was serviced, the rom bank was switched or the block's ram was written to
+	if (reg_PC != (Address)(pc + length) || blockCache->hasLeft())
+		return -1;
+	return nativeQuiet();
+}
+
+Byte Emulator::nativeRead(Emulator * emu, int address)
+{
+	return emu->readMemory((Word)address);
+}
+
+int Emulator::nativeStore(Emulator * emu, int write, int pc, int cycles)
+{
+	int length = write >> 24;
+	emu->nativeFlush(cycles & 0xFFFF);
+	emu->reg_PC = (Address)(pc + length);
+	emu->writeMemory((Word)write, (Byte)(write >> 16));
+	return emu->nativeSynced((Address)pc, length, cycles >> 16);
+}
+
+int Emulator::nativeExecute(Emulator * emu, int op, int pc, int pending)
+{
+	emu->nativeFlush(pending);
+	emu->reg_PC = (Address)pc;
+	(emu->*decodedOpcodeTable[op & 0xFF])((Byte)(op >> 8), (Byte)(op >> 16));
+	return emu->nativeSynced((Address)pc, op >> 24, emu->num_cycles);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+#include "types.h"
+
+class Emulator;
+struct MicroOp;
+
+//native code is only generated on x86-64, every other host runs CPU_JIT as the block cache
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+/*A compiled block, runs from the block's instruction at index entry for as long as the hardware stays quiet (quiet 
+is Emulator::nativeQuiet when it's entered) & leaves the PC at the first instruction it didn't run*/
+typedef void (*JitFunction)(Emulator * emu, int quiet, int entry);
+
+const size_t JIT_ARENA_SIZE = 8 * 1024 * 1024;
+
+/*Memory that hot blocks get compiled into, writable while a block is being compiled & executable otherwise.
+
+Compiled code keeps the gameboy registers in host registers (A & F in bh & bl, the other pairs in r12-r14 & SP
+in bp) for the whole block. Loads, stores to plain work & high ram, the alu, rotates, bit operations & jumps are
+all done inline; the timers, graphics & interrupts aren't touched at all while nothing they do can be seen. The
+block is split into chunks that each start by taking their worst case cycles off the quiet cycles it was handed
+& leave if that runs out, the cycles the chunk's instructions took are added straight to totalCycles & the
+graphics' pending cycles when it leaves or calls out, same as catchUp would have done one at a time. Stores
+to io (or anywhere that isn't plain ram), anything touching the stack & the rarer instructions call back into
+the emulator (Emulator::nativeStore & nativeExecute), which lets the hardware catch up for real & hands back how
+long it'll stay quiet now, or that the block has to be left. Code can be entered at the start of any chunk & after 
+any instruction that calls out, jumps back into the block go straight to the chunk they land in. HALT is done 
+inline too, it hands over the rest of the quiet cycles & leaves. Jumps & falling off the end go straight on to the 
+compiled code for the rom block they land in (in bank 0 or the block's own bank) once there is some, so the last
+block the code left from is kept in Emulator::nativeKey. Compiled code is never freed on its own, once the arena 
+fills up everything gets thrown away & recompiled when it's hot again.*/
+class JitArena
+{
+public:
+	JitArena(size_t size);
+	~JitArena();
+
+	bool usable() const { return code != NULL; }
+
+	/*Compiles the block at key (rom bank << 16 | address like the block cache), NULL when the arena is full. 
+	entryPoints gets which of the instructions the code can be entered at.*/
+	JitFunction compile(const Emulator & emu, const std::vector<MicroOp> & ops, uint32_t key, std::vector<bool> & entryPoints);
+
+	//only safe when none of the compiled code is running
+	void reset();
+
+private:
+	Byte * code; //starts with the table compiled code turns host flags into gameboy ones with
+	size_t size;
+	size_t used;
+
+	//rom blocks' chain entries by key & the exits still waiting for the block they go to to be compiled
+	std::unordered_map<uint32_t, size_t> chainEntries;
+	std::unordered_multimap<uint32_t, size_t> unlinked;
+
+	void release();
+	void link(size_t jump, size_t target);
+
+	//flips the arena between writable (while compiling) & executable, false when the host won't
+	bool protect(bool executable);
+};
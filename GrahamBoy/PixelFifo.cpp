@@ -0,0 +1,336 @@
+#include "PixelFifo.h"
+#include "Emulator.h"
+#include <string.h>
+
+PixelFifo::PixelFifo()
+{
+	enabled = false;
+	layersCleared = false;
+	dot = 0;
+	mode = 0;
+	statLine = false;
+	windowReachedY = false;
+	windowActive = false;
+	windowLine = 0;
+	lineSpriteCount = 0;
+	x = 0;
+	discard = 0;
+	stall = 0;
+	fetchStep = 0;
+	fetchX = 0;
+	tileAddress = 0x8000;
+	tileLow = tileHigh = 0;
+	backgroundCount = 0;
+	backgroundHead = 0;
+	memset(spriteFifo, 0, sizeof(spriteFifo));
+	spriteHead = 0;
+}
+
+void PixelFifo::step(Emulator & emu, int cycles)
+{
+	if (!testBit(emu.memory[0xFF40], 7))
+	{
+		if (enabled)
+			disable(emu);
+		return;
+	}
+
+	//turning the lcd on starts a new frame from the top
+	if (!enabled)
+	{
+		enabled = true;
+		if (!layersCleared)
+		{
+			memset(emu.windowData, 0, sizeof(emu.windowData));
+			memset(emu.spriteData, 0, sizeof(emu.spriteData));
+			layersCleared = true;
+		}
+
+		dot = 0;
+		emu.memory[0xFF44] = 0;
+		windowLine = 0;
+		windowReachedY = false;
+		windowActive = false;
+		startLine(emu);
+	}
+
+	while (cycles > 0)
+	{
+		if (mode == 3)
+		{
+			transferDot(emu);
+			dot++;
+			cycles--;
+			if (x == width)
+				setMode(emu, 0);
+			continue;
+		}
+
+		//nothing happens in the other modes until they end
+		int end = (mode == 2) ? OAM_SCAN_DOTS : DOTS_PER_LINE;
+		int dots = (end - dot < cycles) ? end - dot : cycles;
+		dot += dots;
+		cycles -= dots;
+
+		if (dot == DOTS_PER_LINE)
+			nextLine(emu);
+		else if (mode == 2 && dot == OAM_SCAN_DOTS)
+			startTransfer(emu);
+	}
+
+	//the cpu could have written LYC or the interrupt enables of STAT
+	updateStat(emu);
+}
+
+void PixelFifo::disable(Emulator & emu)
+{
+	enabled = false;
+	dot = 0;
+	mode = 0;
+	statLine = false;
+	emu.memory[0xFF44] = 0;
+	emu.memory[0xFF41] &= 0xFC;
+}
+
+void PixelFifo::nextLine(Emulator & emu)
+{
+	if (windowActive)
+		windowLine++;
+	windowActive = false;
+	dot = 0;
+
+	Byte line = emu.memory[0xFF44] + 1;
+	if (line > 153)
+	{
+		line = 0;
+		windowLine = 0;
+		windowReachedY = false;
+	}
+	emu.memory[0xFF44] = line;
+
+	if (line == height)
+	{
+		setMode(emu, 1);
+		emu.requestInterrupt(INTERRUPT_VBLANK);
+		if (!emu.headless)
+			emu.renderScreen();
+	}
+	else if (line < height)
+		startLine(emu);
+	else
+		updateStat(emu); //LY changed
+}
+
+void PixelFifo::startLine(Emulator & emu)
+{
+	if (emu.memory[0xFF44] == emu.memory[0xFF4A])
+		windowReachedY = true;
+
+	scanOam(emu);
+	setMode(emu, 2);
+}
+
+//the first 10 sprites in oam that are on the line, the rest don't get drawn
+void PixelFifo::scanOam(Emulator & emu)
+{
+	int spriteHeight = testBit(emu.memory[0xFF40], 2) ? 16 : 8;
+	int line = emu.memory[0xFF44] + 16; //oam y is 16 above the screen
+
+	lineSpriteCount = 0;
+	for (int sprite = 0; sprite < 40 && lineSpriteCount < 10; sprite++)
+	{
+		int y = emu.memory[0xFE00 + sprite * 4];
+		if (line >= y && line < y + spriteHeight)
+		{
+			spriteFetched[lineSpriteCount] = false;
+			lineSprites[lineSpriteCount++] = sprite;
+		}
+	}
+}
+
+void PixelFifo::startTransfer(Emulator & emu)
+{
+	x = 0;
+	discard = emu.memory[0xFF43] & 7;
+	stall = 6; //the first fetch of the line gets thrown away
+	fetchStep = 0;
+	fetchX = 0;
+	backgroundCount = 0;
+	backgroundHead = 0;
+	memset(spriteFifo, 0, sizeof(spriteFifo));
+	spriteHead = 0;
+	windowActive = false;
+	setMode(emu, 3);
+}
+
+void PixelFifo::transferDot(Emulator & emu)
+{
+	if (stall > 0)
+	{
+		stall--;
+		return;
+	}
+
+	Byte control = emu.memory[0xFF40];
+
+	//the window starts over with an empty fifo & a fetch from its first column
+	Byte windowX = emu.memory[0xFF4B];
+	if (!windowActive && windowReachedY && testBit(control, 5) && windowX <= 166 && x + 7 >= windowX)
+	{
+		windowActive = true;
+		backgroundCount = 0;
+		fetchStep = 0;
+		fetchX = 0;
+		discard = (windowX < 7) ? 7 - windowX : 0;
+	}
+
+	/*A sprite starting at x holds everything up while its row gets fetched: 6 dots plus however much of the
+	background fetch that's going on is left. Only once the fifo has something in it & the scroll has been thrown away.*/
+	if (testBit(control, 1) && discard == 0 && backgroundCount > 0)
+	{
+		for (int sprite = 0; sprite < lineSpriteCount; sprite++)
+		{
+			if (spriteFetched[sprite] || emu.memory[0xFE00 + lineSprites[sprite] * 4 + 1] > x + 8)
+				continue;
+
+			fetchSprite(emu, sprite);
+			int penalty = 6 + ((fetchStep < 5) ? 5 - fetchStep : 0);
+			stall = penalty - 1; //this dot is the first of them
+			return;
+		}
+	}
+
+	fetcherDot(emu);
+	outputPixel(emu);
+}
+
+//tile number, low byte & high byte take 2 dots each, the row gets pushed once the fifo is empty
+void PixelFifo::fetcherDot(Emulator & emu)
+{
+	const Byte * memory = emu.memory;
+	Byte control = memory[0xFF40];
+
+	if (fetchStep == 1)
+	{
+		Word map;
+		int row;
+		if (windowActive)
+		{
+			map = (testBit(control, 6) ? 0x9C00 : 0x9800) + (windowLine >> 3) * 32 + (fetchX & 31);
+			row = windowLine & 7;
+		}
+		else
+		{
+			Byte y = memory[0xFF42] + memory[0xFF44];
+			map = (testBit(control, 3) ? 0x9C00 : 0x9800) + (y >> 3) * 32 + (((memory[0xFF43] >> 3) + fetchX) & 31);
+			row = y & 7;
+		}
+
+		Byte id = memory[map];
+		tileAddress = (testBit(control, 4) ? 0x8000 + id * 16 : 0x9000 + (Byte_Signed)id * 16) + row * 2;
+	}
+	else if (fetchStep == 3)
+		tileLow = memory[tileAddress];
+	else if (fetchStep == 5)
+		tileHigh = memory[tileAddress + 1];
+
+	if (fetchStep < 6)
+		fetchStep++;
+
+	if (fetchStep == 6 && backgroundCount == 0)
+	{
+		for (int pixel = 0; pixel < 8; pixel++)
+			backgroundFifo[pixel] = (((tileHigh >> (7 - pixel)) & 1) << 1) | ((tileLow >> (7 - pixel)) & 1);
+		backgroundCount = 8;
+		backgroundHead = 0;
+		fetchStep = 0;
+		fetchX++;
+	}
+}
+
+//mixes the sprite's row into the sprite fifo, pixels already there from an earlier sprite stay
+void PixelFifo::fetchSprite(Emulator & emu, int sprite)
+{
+	spriteFetched[sprite] = true;
+
+	const Byte * attributes = &emu.memory[0xFE00 + lineSprites[sprite] * 4];
+	Byte flags = attributes[3];
+	int spriteHeight = testBit(emu.memory[0xFF40], 2) ? 16 : 8;
+	int row = emu.memory[0xFF44] + 16 - attributes[0];
+	if (testBit(flags, 6)) //y flip
+		row = spriteHeight - 1 - row;
+
+	Byte tile = (spriteHeight == 16) ? attributes[2] & 0xFE : attributes[2];
+	Byte low = emu.memory[0x8000 + tile * 16 + row * 2];
+	Byte high = emu.memory[0x8000 + tile * 16 + row * 2 + 1];
+
+	for (int pixel = 0; pixel < 8; pixel++)
+	{
+		int slot = attributes[1] - 8 + pixel - x; //off the left of the screen or already drawn when < 0
+		if (slot < 0)
+			continue;
+
+		int bit = testBit(flags, 5) ? pixel : 7 - pixel; //x flip
+		Byte colour = (((high >> bit) & 1) << 1) | ((low >> bit) & 1);
+		SpritePixel & out = spriteFifo[(spriteHead + slot) & 7];
+		if (colour == 0 || out.colour != 0)
+			continue;
+
+		out.colour = colour;
+		out.palette = testBit(flags, 4) ? 1 : 0;
+		out.behindBackground = testBit(flags, 7);
+	}
+}
+
+void PixelFifo::outputPixel(Emulator & emu)
+{
+	if (backgroundCount == 0)
+		return;
+
+	Byte colour = backgroundFifo[backgroundHead++];
+	backgroundCount--;
+	if (discard > 0)
+	{
+		discard--;
+		return;
+	}
+
+	Byte control = emu.memory[0xFF40];
+	bool backgroundOn = testBit(control, 0);
+	if (!backgroundOn)
+		colour = 0;
+
+	SpritePixel & sprite = spriteFifo[spriteHead];
+	uint32_t pixel;
+	if (sprite.colour != 0 && testBit(control, 1) && !(sprite.behindBackground && colour != 0))
+		pixel = emu.spriteColours[sprite.palette][sprite.colour];
+	else
+		pixel = backgroundOn ? emu.windowColours[colour] : emu.colorShades[0];
+
+	emu.bgData[emu.memory[0xFF44] * width + x] = pixel;
+	sprite.colour = 0;
+	spriteHead = (spriteHead + 1) & 7;
+	x++;
+}
+
+void PixelFifo::setMode(Emulator & emu, int newMode)
+{
+	mode = newMode;
+	updateStat(emu);
+}
+
+/*The mode & coincidence bits of STAT. The stat interrupt only gets requested when the line (any of the enabled
+conditions holding) goes high, one condition taking over from another straight away doesn't request another.*/
+void PixelFifo::updateStat(Emulator & emu)
+{
+	Byte status = emu.memory[0xFF41];
+	bool coincidence = emu.memory[0xFF44] == emu.memory[0xFF45];
+	status = (status & 0xF8) | (coincidence ? 0x04 : 0) | mode;
+	emu.memory[0xFF41] = status;
+
+	bool line = (coincidence && testBit(status, 6)) || (mode == 0 && testBit(status, 3)) ||
+		(mode == 1 && testBit(status, 4)) || (mode == 2 && testBit(status, 5));
+	if (line && !statLine)
+		emu.requestInterrupt(INTERRUPT_LCD);
+	statLine = line;
+}
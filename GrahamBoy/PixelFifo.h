@@ -0,0 +1,77 @@
+#pragma once
+#include "types.h"
+
+class Emulator;
+
+/*The lcd of the PPU_PIXEL_FIFO tier, stepped a dot (clock cycle) at a time. Mode 2 picks the (up to 10) sprites
+on the line out of oam. Mode 3 has a fetcher reading the background or window a tile row at a time into a fifo
+that shifts a pixel out onto the screen every dot: it starts with a wasted fetch, throws away the SCX & 7 pixels
+scrolled off the left, starts over when the window begins & stops for every sprite it reaches so the sprite's row
+can be fetched & mixed into the sprite fifo. Mode 0 is whatever is left of the 456 dots. Only modes 0, 1 & 2 are
+skipped through in one go.
+
+LY, the mode & coincidence bits of STAT & the stat interrupt (requested when any of the enabled conditions goes
+from none holding to one holding) are kept up to date dot by dot. The finished pixels go straight into bgData,
+the window & sprite layers are left empty.*/
+class PixelFifo
+{
+public:
+	PixelFifo();
+
+	//the lcd takes cycles more dots
+	void step(Emulator & emu, int cycles);
+
+private:
+	static const int DOTS_PER_LINE = 456;
+	static const int OAM_SCAN_DOTS = 80;
+
+	struct SpritePixel
+	{
+		Byte colour; //0 is transparent
+		Byte palette; //0 = OBP0, 1 = OBP1
+		bool behindBackground;
+	};
+
+	bool enabled; //the lcd was on last step
+	bool layersCleared; //the window & sprite layers have been emptied
+	int dot; //into the current line
+	int mode;
+	bool statLine; //the stat interrupt line as of the last dot, interrupts get requested when it goes high
+
+	//window
+	bool windowReachedY; //LY has matched WY this frame
+	bool windowActive; //the fetcher is on the window for the rest of the line
+	int windowLine; //the window's own line counter, only counts lines the window was drawn on
+
+	//the sprites mode 2 picked for the line in oam order & whether mode 3 has fetched them yet
+	Byte lineSprites[10];
+	bool spriteFetched[10];
+	int lineSpriteCount;
+
+	//mode 3
+	int x; //next pixel on the screen
+	int discard; //pixels of the first tile still to be thrown away (SCX & 7)
+	int stall; //dots the fetcher & the fifos are held up for
+	int fetchStep; //0-5 fetching the tile number, low & high byte (2 dots each), 6 = waiting to push
+	int fetchX; //tile column of the map the fetcher is on
+	Word tileAddress; //of the row the fetcher is reading
+	Byte tileLow;
+	Byte tileHigh;
+	Byte backgroundFifo[8];
+	int backgroundCount;
+	int backgroundHead;
+	SpritePixel spriteFifo[8]; //spriteHead is the pixel that goes out next
+	int spriteHead;
+
+	void disable(Emulator & emu);
+	void nextLine(Emulator & emu);
+	void startLine(Emulator & emu);
+	void scanOam(Emulator & emu);
+	void startTransfer(Emulator & emu);
+	void transferDot(Emulator & emu);
+	void fetcherDot(Emulator & emu);
+	void fetchSprite(Emulator & emu, int sprite);
+	void outputPixel(Emulator & emu);
+	void setMode(Emulator & emu, int newMode);
+	void updateStat(Emulator & emu);
+};
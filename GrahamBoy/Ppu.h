@@ -0,0 +1,31 @@
+#pragma once
+#include "types.h"
+
+class Emulator;
+
+//how accurately the lcd gets stepped, picked before run like the cpu engine (see ScanlinePpu & PixelFifoPpu)
+enum PpuTier
+{
+	PPU_SCANLINE,
+	PPU_PIXEL_FIFO //see PixelFifo.h
+};
+
+/*The run loop is a template over one of these as well as the profiler, each tier gets its own instantiation of it
+so nothing the other tier needs is ever checked while it runs.
+
+ScanlinePpu is the regular lcd: whole scanlines drawn in one go once they've finished, mode 3 always 172 cycles &
+the lcd put off until it's about to do something (see graphicsSlack). Only it can have idle & copy loops skipped
+or blocks run natively since those hand the lcd their cycles in one go (see quietCycles).*/
+struct ScanlinePpu
+{
+	static const bool SKIPS_AHEAD = true;
+	static void step(Emulator & emu, int cycles);
+};
+
+/*Steps the lcd a dot at a time through a pixel fifo (see PixelFifo.h), mode 3 takes as long as the fetches in it
+do & STAT changes when the hardware's does. Every instruction gets interpreted or run from the block cache.*/
+struct PixelFifoPpu
+{
+	static const bool SKIPS_AHEAD = false;
+	static void step(Emulator & emu, int cycles);
+};
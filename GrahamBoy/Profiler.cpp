@@ -0,0 +1,166 @@
+#include "Profiler.h"
+#include "Emulator.h"
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+GuestProfiler::GuestProfiler()
+{
+	unbanked.assign(0x10000, Counter{ 0, 0 });
+
+	memset(opcodeCount, 0, sizeof(opcodeCount));
+	memset(opcodeCycles, 0, sizeof(opcodeCycles));
+	memset(cbOpcodeCount, 0, sizeof(cbOpcodeCount));
+	memset(cbOpcodeCycles, 0, sizeof(cbOpcodeCycles));
+
+	instructions = runningCycles = haltedCycles = 0;
+	current = NULL;
+	currentCode = currentCBCode = 0;
+	currentHalted = false;
+}
+
+void GuestProfiler::beginInstruction(const Emulator & emu)
+{
+	Address pc = emu.reg_PC;
+
+	if (pc >= 0x4000 && pc <= 0x7FFF)
+	{
+		std::vector<Counter> & bank = romBanks[emu.currentRomBank & 0x7F];
+		if (bank.empty())
+			bank.assign(0x4000, Counter{ 0, 0 });
+
+		current = &bank[pc - 0x4000];
+	}
+	else
+		current = &unbanked[pc];
+
+	currentCode = emu.peekCode(pc);
+	currentCBCode = (currentCode == 0xCB) ? emu.peekCode(pc + 1) : 0;
+	currentHalted = emu.halted; //already sitting on a HALT before this instruction
+}
+
+void GuestProfiler::endInstruction(int cycles)
+{
+	current->instructions++;
+	current->cycles += cycles;
+	instructions++;
+
+	if (currentCode == 0xCB)
+	{
+		cbOpcodeCount[currentCBCode]++;
+		cbOpcodeCycles[currentCBCode] += cycles;
+	}
+	else
+	{
+		opcodeCount[currentCode]++;
+		opcodeCycles[currentCode] += cycles;
+	}
+
+	if (currentHalted)
+		haltedCycles += cycles;
+	else
+		runningCycles += cycles;
+}
+
+//the mnemonic tables hold printf formats for the operands, swap them for something readable
+static std::string operandPlaceholders(const char * mnemonic)
+{
+	static const char * const formats[][2] = {
+		{ "$%04x", "a16" }, { "$%04hx", "a16" }, { "$ff%02hhx", "$ff00+a8" },
+		{ "%+hhd", "e8" }, { "%hhd", "e8" }, { "%hhu", "n8" }, { "%hu", "n16" },
+	};
+
+	std::string text = mnemonic;
+	for (const auto & format : formats)
+	{
+		size_t at = text.find(format[0]);
+		if (at != std::string::npos)
+			text.replace(at, strlen(format[0]), format[1]);
+	}
+
+	return text;
+}
+
+void GuestProfiler::report(const Emulator & emu, FILE * out, int maxHotSpots) const
+{
+	struct HotSpot
+	{
+		int bank;
+		Address pc;
+		Counter counter;
+	};
+
+	std::vector<HotSpot> spots;
+
+	for (int pc = 0; pc < 0x10000; pc++)
+	{
+		if (unbanked[pc].instructions)
+			spots.push_back({ 0, (Address)pc, unbanked[pc] });
+	}
+
+	for (int bank = 0; bank < 0x80; bank++)
+	{
+		for (size_t offset = 0; offset < romBanks[bank].size(); offset++)
+		{
+			if (romBanks[bank][offset].instructions)
+				spots.push_back({ bank, (Address)(0x4000 + offset), romBanks[bank][offset] });
+		}
+	}
+
+	std::sort(spots.begin(), spots.end(), [](const HotSpot & a, const HotSpot & b) { return a.counter.cycles > b.counter.cycles; });
+
+	uint64_t totalCycles = runningCycles + haltedCycles;
+	double toPercent = totalCycles ? 100.0 / (double)totalCycles : 0.0;
+
+	fprintf(out, "instructions: %llu  cycles: %llu  running: %.1f%%  halted: %.1f%%\n\n",
+		(unsigned long long)instructions, (unsigned long long)totalCycles, runningCycles * toPercent, haltedCycles * toPercent);
+
+	fprintf(out, "%-9s %12s %14s %7s  %s\n", "bank:pc", "count", "cycles", "%", "instruction");
+	for (int i = 0; i < (int)spots.size() && i < maxHotSpots; i++)
+	{
+		const HotSpot & spot = spots[i];
+
+		/*Read the bytes from the bank that was actually profiled, not whatever bank is mapped in right now. Only spots in 
+		0x4000-0x7FFF have one, the operands of an instruction just below 0x4000 come from the bank mapped in now.*/
+		bool banked = spot.pc >= 0x4000 && spot.pc <= 0x7FFF;
+		Byte bytes[3];
+		for (int j = 0; j < 3; j++)
+		{
+			Address addr = spot.pc + j;
+			if (banked && addr <= 0x7FFF)
+				bytes[j] = emu.cartridgeMemory[(addr - 0x4000) + (spot.bank * 0x4000)];
+			else
+				bytes[j] = emu.peekCode(addr);
+		}
+
+		char disassembly[64];
+		emulator_disassemble(spot.pc, bytes[0], bytes[1], bytes[2], disassembly, sizeof(disassembly));
+
+		fprintf(out, "%02X:%04X %12llu %14llu %6.2f%%  %s\n", spot.bank, spot.pc,
+			(unsigned long long)spot.counter.instructions, (unsigned long long)spot.counter.cycles,
+			spot.counter.cycles * toPercent, disassembly + 8); //skip the address, it's already in the first column
+	}
+
+	//opcode histograms, sorted by cycles
+	for (int cb = 0; cb < 2; cb++)
+	{
+		const uint64_t * count = cb ? cbOpcodeCount : opcodeCount;
+		const uint64_t * cycles = cb ? cbOpcodeCycles : opcodeCycles;
+
+		std::vector<int> codes;
+		for (int code = 0; code < 256; code++)
+		{
+			if (count[code])
+				codes.push_back(code);
+		}
+		std::sort(codes.begin(), codes.end(), [cycles](int a, int b) { return cycles[a] > cycles[b]; });
+
+		fprintf(out, "\n%-9s %12s %14s %7s  %s\n", cb ? "cb opcode" : "opcode", "count", "cycles", "%", "mnemonic");
+		for (int code : codes)
+		{
+			fprintf(out, "%s%02X     %12llu %14llu %6.2f%%  %s\n", cb ? "CB " : "   ", code,
+				(unsigned long long)count[code], (unsigned long long)cycles[code], cycles[code] * toPercent,
+				operandPlaceholders(emulator_mnemonic(code, cb != 0)).c_str());
+		}
+	}
+}
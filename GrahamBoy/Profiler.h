@@ -0,0 +1,56 @@
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include "types.h"
+
+class Emulator;
+
+/*The run loop is a template over one of these so profiling costs nothing unless it's asked for. The 
+regular build runs with NullProfiler whose hooks are empty and get inlined away, GuestProfiler is a 
+separate instantiation of the same loop that counts every instruction the game executes.*/
+struct NullProfiler
+{
+	void beginInstruction(const Emulator & emu) {}
+	void endInstruction(int cycles) {}
+};
+
+/*Counts instructions & clock cycles per (rom bank, PC) plus a histogram of every opcode & CB opcode. 
+Cycles spent sitting on a HALT (waiting for an interrupt) are kept apart from cycles spent actually 
+running so an idle game doesn't look like it has a hot spot on its HALT instruction.*/
+class GuestProfiler
+{
+public:
+	GuestProfiler();
+
+	void beginInstruction(const Emulator & emu);
+	void endInstruction(int cycles);
+
+	//hot spots are sorted by clock cycles & disassembled using the emulator's current memory
+	void report(const Emulator & emu, FILE * out, int maxHotSpots) const;
+
+private:
+	struct Counter
+	{
+		uint64_t instructions;
+		uint64_t cycles;
+	};
+
+	//0x4000-0x7FFF is split up per rom bank (only allocated once code runs from that bank), everything else is keyed by PC alone
+	std::vector<Counter> romBanks[0x80];
+	std::vector<Counter> unbanked;
+
+	uint64_t opcodeCount[256];
+	uint64_t opcodeCycles[256];
+	uint64_t cbOpcodeCount[256];
+	uint64_t cbOpcodeCycles[256];
+
+	uint64_t instructions;
+	uint64_t runningCycles;
+	uint64_t haltedCycles;
+
+	//the instruction currently being executed (set by beginInstruction)
+	Counter * current;
+	Byte currentCode;
+	Byte currentCBCode;
+	bool currentHalted;
+};
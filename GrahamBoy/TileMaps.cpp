@@ -0,0 +1,42 @@
+#include "TileMaps.h"
+#include <string.h>
+
+TileMaps::TileMaps()
+{
+	memset(pixels, 0, sizeof(pixels));
+	memset(cellDirty, 0, sizeof(cellDirty));
+	memset(tileDirty, 0, sizeof(tileDirty));
+	mapDirty[0] = mapDirty[1] = true;
+	drawnWith[0] = drawnWith[1] = -1;
+}
+
+void TileMaps::refresh(const Byte * memory, int map, bool unsignedTiles)
+{
+	bool redrawAll = drawnWith[map] != (int)unsignedTiles;
+	const Byte * cells = &memory[map ? 0x9C00 : 0x9800];
+
+	for (int cell = 0; cell < 32 * 32; cell++)
+	{
+		//tile data index of the cell's tile, 0x8000 + id * 16 or 0x9000 + signed id * 16
+		Byte id = cells[cell];
+		int tile = (unsignedTiles || id >= 0x80) ? id : 0x100 + id;
+
+		if (!redrawAll && !cellDirty[map][cell] && !tileDirty[map][tile])
+			continue;
+		cellDirty[map][cell] = false;
+
+		const Byte * data = &memory[0x8000 + tile * 16];
+		Byte * out = &pixels[map][(cell >> 5) * 8 * 256 + (cell & 31) * 8];
+		for (int y = 0; y < 8; y++, out += 256)
+		{
+			Byte low = data[y * 2];
+			Byte high = data[y * 2 + 1];
+			for (int x = 0; x < 8; x++)
+				out[x] = ((low >> (7 - x)) & 1) | (((high >> (7 - x)) & 1) << 1);
+		}
+	}
+
+	memset(tileDirty[map], 0, sizeof(tileDirty[map]));
+	mapDirty[map] = false;
+	drawnWith[map] = unsignedTiles;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "types.h"
+
+/*The two 32x32 tile maps (0x9800 & 0x9C00) kept drawn out as 256x256 bitmaps of colour numbers (0-3, bit 0 from the
+first byte of each tile row, bit 1 from the second) so a scanline is a copy out of one of their rows instead of
+looking every pixel's tile up again. They're drawn with whichever tile data LCDC bit 4 picks when they get used.
+
+A write to a map only redraws its cell. A write to tile data marks the tile, the next time a map gets used any of
+its cells showing a marked tile get redrawn. Changing the tile data select redraws the whole map. Everything that
+writes vram has to tell it (see written).*/
+class TileMaps
+{
+public:
+	TileMaps();
+
+	//something wrote to vram
+	void written(Word address)
+	{
+		if (address >= 0x9800)
+		{
+			int map = (address >> 10) & 1;
+			cellDirty[map][address & 0x3FF] = true;
+			mapDirty[map] = true;
+		}
+		else
+		{
+			tileDirty[0][(address - 0x8000) >> 4] = tileDirty[1][(address - 0x8000) >> 4] = true;
+			mapDirty[0] = mapDirty[1] = true;
+		}
+	}
+
+	//the 256 colour numbers of row y of map 0 (0x9800) or 1 (0x9C00), memory is the emulator's
+	const Byte * row(const Byte * memory, int map, bool unsignedTiles, int y)
+	{
+		if (mapDirty[map] || drawnWith[map] != (int)unsignedTiles)
+			refresh(memory, map, unsignedTiles);
+		return &pixels[map][y * 256];
+	}
+
+private:
+	static const int TILES = 384; //0x8000-0x97FF
+
+	Byte pixels[2][256 * 256];
+	bool cellDirty[2][32 * 32];
+	bool tileDirty[2][TILES];
+	bool mapDirty[2];
+	int drawnWith[2]; //the unsignedTiles the map was drawn with, -1 before it's been drawn
+
+	void refresh(const Byte * memory, int map, bool unsignedTiles);
+};
@@ -0,0 +1,303 @@
+#include "Trace.h"
+#include "Emulator.h"
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <chrono>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+static TraceFileHeader makeHeader(uint64_t dropped)
+{
+	TraceFileHeader header;
+	memcpy(header.magic, "GBTRACE1", sizeof(header.magic));
+	header.recordSize = sizeof(TraceRecord);
+	header.reserved = 0;
+	header.dropped = dropped;
+	return header;
+}
+
+static void writeHeader(FILE * out, uint64_t dropped)
+{
+	TraceFileHeader header = makeHeader(dropped);
+	fwrite(&header, sizeof(header), 1, out);
+}
+
+//the tracer whose buffer gets dumped if the emulator crashes, into a file that was opened beforehand
+static const InstructionTracer * s_crash_tracer = NULL;
+static int s_crash_file = -1;
+
+InstructionTracer::InstructionTracer(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	ring.resize(size);
+	mask = size - 1;
+	written = 0;
+
+	stream = NULL;
+	streaming = false;
+	streamed = 0;
+	dropped = 0;
+}
+
+InstructionTracer::~InstructionTracer()
+{
+	stopStreaming();
+
+	if (s_crash_tracer == this)
+	{
+		s_crash_tracer = NULL;
+#ifdef _WIN32
+		_close(s_crash_file);
+#else
+		close(s_crash_file);
+#endif
+		s_crash_file = -1;
+	}
+}
+
+void InstructionTracer::beginInstruction(const Emulator & emu)
+{
+	uint64_t index = written.load(std::memory_order_relaxed);
+	TraceRecord & record = ring[index & mask];
+
+	Address pc = emu.reg_PC;
+	record.cycle = emu.totalCycles;
+	record.pc = pc;
+	record.bank = (pc >= 0x4000 && pc <= 0x7FFF) ? emu.currentRomBank : 0;
+	record.opcode = emu.peekCode(pc);
+	record.operand1 = emu.peekCode(pc + 1);
+	record.operand2 = emu.peekCode(pc + 2);
+	record.a = emu.reg_AF.hi; record.f = emu.computeFlags();
+	record.b = emu.reg_BC.hi; record.c = emu.reg_BC.lo;
+	record.d = emu.reg_DE.hi; record.e = emu.reg_DE.lo;
+	record.h = emu.reg_HL.hi; record.l = emu.reg_HL.lo;
+	record.sp = emu.reg_SP;
+
+	//publish the record to the writer thread
+	written.store(index + 1, std::memory_order_release);
+}
+
+bool InstructionTracer::dump(const char * path) const
+{
+	FILE * out;
+	if (fopen_s(&out, path, "wb") != 0 || out == NULL)
+		return false;
+
+	uint64_t end = written.load(std::memory_order_acquire);
+	uint64_t count = (end < ring.size()) ? end : ring.size();
+	uint64_t start = end - count;
+
+	writeHeader(out, start);
+
+	//the oldest record isn't necessarily at the front of the ring, write it in (at most) two pieces
+	size_t first = (size_t)(start & mask);
+	size_t firstCount = (size_t)((count < ring.size() - first) ? count : ring.size() - first);
+	fwrite(&ring[first], sizeof(TraceRecord), firstCount, out);
+	fwrite(&ring[0], sizeof(TraceRecord), (size_t)(count - firstCount), out);
+
+	fclose(out);
+	return true;
+}
+
+bool InstructionTracer::startStreaming(const char * path)
+{
+	if (fopen_s(&stream, path, "wb") != 0 || stream == NULL)
+		return false;
+
+	writeHeader(stream, 0);
+	chunk.resize(4096);
+	streamed = written.load(std::memory_order_acquire);
+	dropped = streamed; //anything recorded before streaming started never makes it into the file
+	streaming = true;
+	writer = std::thread(&InstructionTracer::streamRecords, this);
+	return true;
+}
+
+void InstructionTracer::stopStreaming()
+{
+	if (!streaming)
+		return;
+
+	streaming = false;
+	writer.join();
+	flushStream(); //whatever came in after the writer's last pass
+
+	//now the total # of dropped records is known, patch it into the header
+	fseek(stream, 0, SEEK_SET);
+	writeHeader(stream, dropped);
+	fclose(stream);
+	stream = NULL;
+}
+
+void InstructionTracer::streamRecords()
+{
+	while (streaming)
+	{
+		flushStream();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+//writes out everything recorded since the last flush that hasn't been overwritten yet
+void InstructionTracer::flushStream()
+{
+	uint64_t end = written.load(std::memory_order_acquire);
+
+	while (streamed < end)
+	{
+		/*the emulator lapped us, skip ahead to the oldest record still in the ring. The one at end - ring.size() 
+		shares its slot with record end, which beginInstruction could be writing before it publishes end + 1.*/
+		if (end - streamed >= ring.size())
+		{
+			dropped += end - ring.size() + 1 - streamed;
+			streamed = end - ring.size() + 1;
+		}
+
+		size_t first = (size_t)(streamed & mask);
+		size_t count = (size_t)(end - streamed);
+		if (count > ring.size() - first)
+			count = ring.size() - first;
+
+		//copy the records out & then make sure they weren't overwritten while we were copying
+		if (count > chunk.size())
+			count = chunk.size();
+		memcpy(&chunk[0], &ring[first], count * sizeof(TraceRecord));
+
+		//the copy has to be done before written gets looked at again or the check below doesn't cover it
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t now = written.load(std::memory_order_relaxed);
+		uint64_t safeFrom = (now >= ring.size()) ? now - ring.size() + 1 : 0;
+		if (streamed < safeFrom)
+		{
+			//part (or all) of the chunk got overwritten, only keep what's still valid
+			uint64_t lost = safeFrom - streamed;
+			if (lost > count)
+				lost = count;
+			dropped += lost;
+			streamed += lost;
+			count -= (size_t)lost;
+			fwrite(&chunk[(size_t)lost], sizeof(TraceRecord), count, stream);
+		}
+		else
+			fwrite(&chunk[0], sizeof(TraceRecord), count, stream);
+
+		streamed += count;
+		end = now;
+	}
+
+	fflush(stream);
+}
+
+//write() without stdio, the only kind of output that's safe from a signal handler
+static void writeFully(int file, const void * data, size_t size)
+{
+	const char * bytes = (const char *)data;
+	while (size > 0)
+	{
+		unsigned int piece = (size > 0x40000000) ? 0x40000000 : (unsigned int)size;
+#ifdef _WIN32
+		int done = _write(file, bytes, piece);
+#else
+		ssize_t done = write(file, bytes, piece);
+#endif
+		if (done <= 0)
+			return;
+		bytes += done;
+		size -= (size_t)done;
+	}
+}
+
+//same as dump but only with what a signal handler is allowed to call (the crash might be inside malloc or stdio)
+void InstructionTracer::dumpFromSignal(int file) const
+{
+	uint64_t end = written.load(std::memory_order_acquire);
+	uint64_t count = (end < ring.size()) ? end : ring.size();
+	uint64_t start = end - count;
+
+	TraceFileHeader header = makeHeader(start);
+	writeFully(file, &header, sizeof(header));
+
+	size_t first = (size_t)(start & mask);
+	size_t firstCount = (size_t)((count < ring.size() - first) ? count : ring.size() - first);
+	writeFully(file, &ring[first], firstCount * sizeof(TraceRecord));
+	writeFully(file, &ring[0], (size_t)(count - firstCount) * sizeof(TraceRecord));
+}
+
+static void crashHandler(int sig)
+{
+	//best effort: the process is going down anyway so getting the trace out is all that matters
+	if (s_crash_tracer)
+		s_crash_tracer->dumpFromSignal(s_crash_file);
+
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+bool InstructionTracer::dumpOnCrash(const char * path)
+{
+	//opened now, a crashing process can't be trusted to open files
+#ifdef _WIN32
+	int file = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	int file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (file < 0)
+		return false;
+
+	s_crash_file = file;
+	s_crash_tracer = this;
+
+	signal(SIGSEGV, crashHandler);
+	signal(SIGABRT, crashHandler);
+	signal(SIGFPE, crashHandler);
+	signal(SIGILL, crashHandler);
+	return true;
+}
+
+int decodeTrace(const char * path, FILE * out)
+{
+	FILE * in;
+	if (fopen_s(&in, path, "rb") != 0 || in == NULL)
+		return -1;
+
+	TraceFileHeader header;
+	if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, "GBTRACE1", 8) != 0 || header.recordSize != sizeof(TraceRecord))
+	{
+		fclose(in);
+		return -1;
+	}
+
+	if (header.dropped)
+		fprintf(out, "(%llu earlier records were not kept)\n", (unsigned long long)header.dropped);
+
+	TraceRecord records[4096];
+	size_t count;
+	while ((count = fread(records, sizeof(TraceRecord), 4096, in)) > 0)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const TraceRecord & r = records[i];
+
+			char disassembly[64];
+			emulator_disassemble(r.pc, r.opcode, r.operand1, r.operand2, disassembly, sizeof(disassembly));
+
+			fprintf(out, "%12llu %02X:%04X "
+				"A:%02x F:%c%c%c%c B:%02x C:%02x D:%02x E:%02x H:%02x L:%02x SP:%04x | %s\n",
+				(unsigned long long)r.cycle, r.bank, r.pc, r.a,
+				r.f & FLAG_ZERO ? 'Z' : '-', r.f & FLAG_SUB ? 'N' : '-',
+				r.f & FLAG_HALF_CARRY ? 'H' : '-', r.f & FLAG_CARRY ? 'C' : '-',
+				r.b, r.c, r.d, r.e, r.h, r.l, r.sp, disassembly + 8); //address is already printed
+		}
+	}
+
+	fclose(in);
+	return 0;
+}
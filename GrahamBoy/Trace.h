@@ -0,0 +1,76 @@
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "types.h"
+
+class Emulator;
+
+/*One executed instruction as it looked right before it ran. Fixed size & written straight to disk 
+so recording one is just a handful of stores, the text is only produced later by decodeTrace.*/
+struct TraceRecord
+{
+	uint64_t cycle; //total clock cycles executed before this instruction
+	Word pc;
+	Byte bank; //rom bank mapped at 0x4000-0x7FFF when pc is in there, 0 otherwise
+	Byte opcode;
+	Byte operand1; //the two bytes following the opcode (CB opcodes keep their second byte in here)
+	Byte operand2;
+	Byte a, f, b, c, d, e, h, l;
+	Word sp;
+};
+static_assert(sizeof(TraceRecord) == 24, "trace records are written to disk as is");
+
+struct TraceFileHeader
+{
+	char magic[8]; //"GBTRACE1"
+	uint32_t recordSize;
+	uint32_t reserved;
+	uint64_t dropped; //records that were overwritten before they could be written out
+};
+
+/*Records every instruction into a fixed size ring buffer so tracing can be left on for long runs: 
+memory use is capped & only the last N records are kept. The buffer gets written out when the trace 
+is dumped (on exit or when the emulator crashes). Alternatively a background thread can stream the 
+buffer to disk while the emulator keeps running, if the emulator laps the writer the overwritten 
+records are counted as dropped instead of slowing down emulation.
+
+This has the same hooks as the profilers in Profiler.h so it gets its own instantiation of the run loop.*/
+class InstructionTracer
+{
+public:
+	InstructionTracer(size_t capacity);
+	~InstructionTracer();
+
+	void beginInstruction(const Emulator & emu);
+	void endInstruction(int cycles) {}
+
+	//write the records still held in the ring buffer, oldest first
+	bool dump(const char * path) const;
+
+	//keep writing the ring buffer out to path from a background thread until stopStreaming
+	bool startStreaming(const char * path);
+	void stopStreaming();
+
+	//dump the ring buffer to path if the process crashes (SIGSEGV, SIGABRT...), false if path can't be opened
+	bool dumpOnCrash(const char * path);
+	void dumpFromSignal(int file) const;
+
+private:
+	std::vector<TraceRecord> ring;
+	size_t mask; //capacity is a power of 2 so wrapping around is a mask
+	std::atomic<uint64_t> written; //total records ever recorded, the next one goes in ring[written & mask]
+
+	FILE * stream;
+	std::thread writer;
+	std::atomic<bool> streaming;
+	uint64_t streamed;
+	uint64_t dropped;
+	std::vector<TraceRecord> chunk; //records get copied out of the ring in here before being written
+	void streamRecords();
+	void flushStream();
+};
+
+//turns a trace file back into text (one line per instruction) using the disassembler
+int decodeTrace(const char * path, FILE * out);
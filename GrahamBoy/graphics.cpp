@@ -1,8 +1,10 @@
 #include "Emulator.h"
 #include "types.h"
-#include <SDL.h>
+#include "FrameTrace.h"
+#include "Display.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <time.h>
 
@@ -17,17 +19,24 @@ the scanline counter by subtracting its value by the amount of clock cycles the
 took to exectue.*/
 void Emulator::updateGraphics(int cyc)
 {
+	syncGraphics();
 	setLCDStatus();
 
 	if (isLCDEnabled())
 		scanlineCounter -= cyc;
 	else
+	{
+		graphicsSlack = 456; //nothing happens until it gets turned back on, which catches it up
 		return;
+	}
 
+	//until the counter goes below the mode setLCDStatus just saw, stepping it again would only count it down
+	graphicsSlack = scanlineCounter - lcdBandEnd(lcdBand(scanlineCounter + cyc));
 
 	if (scanlineCounter <= 0)
 	{
 		scanlineCounter = 456;
+		graphicsSlack = -1;
 		
 		/*increase the scanline --> cannot use WriteMemory because when the game tries
 		to write to 0xFF44 it resets the current scaline to 0*/
@@ -35,12 +44,18 @@ void Emulator::updateGraphics(int cyc)
 		
 		//entered VBlank period
 		if (currentLine <= 144) //not @ end or b/w VBlank period
-			drawScanLine();
+		{
+			if (undrawnLines == 0)
+				undrawnFrom = currentLine;
+			undrawnLines++;
+		}
 
 		if (currentLine == 144)
 		{
 			requestInterrupt(INTERRUPT_VBLANK);
-			renderScreen();
+			drawPendingLines();
+			if (!headless)
+				renderScreen();
 		}
 
 		if (readMemory(0xFF44) > 153) //@ 153, need to reset
@@ -55,84 +70,67 @@ void Emulator::updateGraphics(int cyc)
 	return;
 }
 
-void Emulator::renderScreen()
+//hands the lcd the cycles updateGraphics put off, none of them got it far enough to do anything
+void Emulator::syncGraphics()
 {
-	//Need tot lock the surfaces and update the pixels individually
-	SDL_LockSurface(bgSurf);
-	int * pixels = (int *)bgSurf->pixels;
-	for (int i = 0; i < 160; i++)
-	{
-		for (int j = 0; j < 144; j++)
-		{
-			if (pixels[j* bgSurf->w + i] != bgData[i + j * width])
-				pixels[j* bgSurf->w + i] = bgData[i + j * width];
-		}
-	}
-	SDL_UnlockSurface(bgSurf);
+	if (graphicsPending > 0 && isLCDEnabled())
+		scanlineCounter -= graphicsPending;
+	graphicsPending = 0;
+}
 
+/*The cpu is about to change something setLCDStatus looks at (the lcd control, STAT, LY, LYC or IF), the cycles 
+before it happened have to be counted with the old value & the next step can't be put off*/
+void Emulator::catchUpGraphics()
+{
+	syncGraphics();
+	graphicsSlack = -1;
+}
 
-	SDL_LockSurface(spriteSurf);
-	pixels = (int *)spriteSurf->pixels;
-	for (int i = 0; i < 160; i++)
-	{
-		for (int j = 0; j < 144; j++)
-		{
-			if (pixels[j* spriteSurf->w + i] != spriteData[i + j * width])
-				pixels[j* spriteSurf->w + i] = spriteData[i + j * width];
-		}
-	}
-	SDL_UnlockSurface(spriteSurf);
+void Emulator::renderScreen()
+{
+	ScopedPhase phase("renderScreen");
 
-	SDL_LockSurface(windowSurf);
-	pixels = (int *)windowSurf->pixels;
-	for (int i = 0; i < 160; i++)
+	display->present();
+
+	frameStats.framePresented(totalCycles);
+	if (showFrameStats && frameStats.framesPresented() % 60 == 0) //about once a second
 	{
-		for (int j = 0; j < 144; j++)
-		{
-			if (pixels[j* windowSurf->w + i] != windowData[i + j * width])
-				pixels[j* windowSurf->w + i] = windowData[i + j * width];
-		}
+		char title[256];
+		frameStats.summary(title, sizeof(title));
+		display->setTitle(title);
 	}
-	SDL_UnlockSurface(windowSurf);
-
-
-	//Apply the image --> blit onto the screenSurface
-	SDL_BlitScaled(bgSurf, NULL, screenSurface, &rec);
-	SDL_BlitScaled(spriteSurf, NULL, screenSurface, &rec);
-	SDL_BlitScaled(windowSurf, NULL, screenSurface, &rec);
-
-	//Update the surface
-	SDL_UpdateWindowSurface(window);
 	
 	return;
 }
 
 void Emulator::initDisplay()
 {
-	int scale = 5;
-
-	if (SDL_Init(SDL_INIT_VIDEO) < 0)
-		exit(-1);
-
-	window = SDL_CreateWindow("Gameboy Emulator", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width * scale, height * scale, SDL_WINDOW_SHOWN);
-	if (window == NULL)
-		exit(-1);
-
 	memset(bgData, 0xFFFFFFFF, width * height * sizeof(int)); //RGBA 255,255,255,255 ==> White
 	memset(windowData, 0x00000000, width * height * sizeof(int)); //RGBA 0 ==> Black & Invisible (alpha = 0)
 	memset(spriteData, 0x00000000, width * height * sizeof(int)); //RGBA 0 ==> Black & Invisible (alpha = 0)
-
-	//need to use surfaces b/c overlapping background/sprites/window together which apparently can't be done on textures
-	bgSurf = SDL_CreateRGBSurfaceFrom((void*)bgData, 160, 144, 32, 160 * sizeof(int), 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
-	windowSurf = SDL_CreateRGBSurfaceFrom((void*)windowData, 160, 144, 32, 160 * sizeof(int), 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
-	spriteSurf = SDL_CreateRGBSurfaceFrom((void*)spriteData, 160, 144, 32, 160 * sizeof(int), 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
-	SDL_SetColorKey(spriteSurf, SDL_TRUE, SDL_MapRGB(spriteSurf->format, 255, 255, 255)); //sets the color key (transparent pixel) in a surface!
-	screenSurface = SDL_GetWindowSurface(window);
-	
-	rec.w = width * 5; rec.h = height * 5; rec.x = 0; rec.y = 0;
 	colorShades[0] = WHITE; colorShades[1] = LIGHT_GREY; colorShades[2] = DARK_GREY; colorShades[3] = BLACK;
-	
-	return;
+	updatePalettes();
+
+	//scanlines still get drawn into the buffers above but there is no window to show them in
+	display = headless ? NULL : new Display(bgData, windowData, spriteData);
+}
+
+//the mode setLCDStatus picks for the current line when the scanline counter is at counter
+int Emulator::lcdBand(int counter) const
+{
+	if (memory[0xFF44] >= 144)
+		return 1;
+	if (counter >= 456 - 80)
+		return 2;
+	if (counter >= 456 - 80 - 172)
+		return 3;
+	return 0;
+}
+
+//the lowest the scanline counter goes before setLCDStatus would pick something other than band
+int Emulator::lcdBandEnd(int band)
+{
+	return (band == 2) ? 456 - 80 : (band == 3) ? 456 - 80 - 172 : 1;
 }
 
 /* The memory address 0xFF41 holds the current status of the LCD. The LCD goes through 4 different modes. These are 
@@ -264,8 +262,21 @@ void Emulator::doDMATransfer(Byte data)
 	//Word address = (data << 6) + (data << 5) + (data << 2); //https://stackoverflow.com/questions/7286226/bitshift-to-multiply-by-any-number
 	Word address = data << 8; //? is the same as multiplying by 100
 
-	for (int i = 0; i < 0xA0; i++)
-		writeMemory(0xFE00 + i, readMemory(address + i));
+	/*The whole lot gets copied in one go straight out of the source page (the 0xA0 bytes never cross into the next 
+	one), anything drawing from oam was drawn before the write to 0xFF46. The transfer really takes 640 cycles and 
+	the cpu can't get at anything but the io registers & high ram until it's over (see readMemory & writeMemory).*/
+	dmaEndsAt = 0; //starting a new transfer cuts the last one short
+	const Byte * page = readPages[address >> 12];
+	if (page)
+		memcpy(&memory[0xFE00], page + (address & 0xFFF), 0xA0);
+	else
+	{
+		for (int i = 0; i < 0xA0; i++)
+			memory[0xFE00 + i] = readMemory(address + i);
+	}
+
+	oamDirty = true;
+	dmaEndsAt = totalCycles + DMA_CYCLES;
 }
 
 /*Real resolution is 256x256 (32x32 tiles). The visual display can show any 160x144 pixels of the 256x256 background, 
@@ -298,23 +309,41 @@ Bit 3: This is the same as Bit6 but for the background not the window
 Bit 2: This is the size of the sprites that need to draw. Unlike tiles that are always 8x8 sprites can be 8x16
 Bit 1: Same as Bit5 but for sprites
 Bit 0: Same as Bit5 and 1 but for the background */
-void Emulator::drawScanLine()
+void Emulator::drawScanLine(Byte line)
 {
+	//line 144 is the first line of vblank, it still counts as finishing (see updateGraphics) but isn't on the screen
+	if (line >= height)
+		return;
+
 	Byte control = readMemory(0xFF40);
 
 	if (testBit(control, 0))
-		renderBackground();
+		renderBackground(line);
 	
 	if (testBit(control, 5))
-		renderWindow();
+		renderWindow(line);
 
-	if (testBit(control, 1))
+	return;
+}
+
+/*Draws the scanlines that finished since the last time. Nothing they use has changed since each of them finished, 
+so it's the same as drawing them one at a time. Sprites used to be redrawn over the whole screen after every 
+scanline, only the last of those was ever seen so they're drawn once after the lot.*/
+void Emulator::drawPendingLines()
+{
+	if (undrawnLines == 0)
+		return;
+
+	ScopedPhase phase("drawScanLine");
+	for (int i = 0; i < undrawnLines; i++)
+		drawScanLine(undrawnFrom + i);
+	undrawnLines = 0;
+
+	if (testBit(readMemory(0xFF40), 1))
 	{
 		memset(spriteData, 0, width * height * sizeof(int));
 		renderSprites();
 	}
-	
-	return;
 }
 
 /*The gameboy has two regions of memory for the background layout which is shared by the window.
@@ -322,93 +351,30 @@ The memory regions are 0x9800-0x9BFF and 0x9C00-9FFF. We need to check bit 3 of
 register to see which region we are using for the background and bit 6 for the window.
 Each byte in the memory region is a tile identification number of what needs to be drawn. This
 identification number is used to lookup the tile data in video ram so we know how to draw it.*/
-void Emulator::renderBackground()
+void Emulator::renderBackground(Byte line)
 {
-	Address tileLocation = 0, backgroundLocation = 0;
-	Address offset;
 	Byte lcdControl = readMemory(0xFF40);
-	Byte currentScanline = readMemory(0xFF44);
-	bool unsig = true;
-
-	backgroundLocation = testBit(lcdControl, 3) ? 0x9C00 : 0x9800;
-	tileLocation = testBit(lcdControl, 4) ? 0x8000 : 0x9000;
-	
-	//check tile data
-	if (!testBit(lcdControl, 4))
-		unsig = false; //using unsigned values
-	
+	Byte currentScanline = line;
 
 	/*ScrollY (0xFF42): The Y Position of the 256x256 pixel BACKGROUND where to start drawing the viewing area from
 	ScrollX (0xFF43): The X Position of the BACKGROUND to start drawing the viewing area from*/
 	Byte scrollY = readMemory(0xFF42);
 	Byte scrollX = readMemory(0xFF43);
 
-	// For each pixel in the 160x1 scanline:
-	// 1. Calculate where the pixel resides in the overall 256x256 background map
-	// 2. Get the tile ID where that pixel is located
-	// 3. Get the pixel color based on that coordinate relative to the 8x8 tile grid
-	// 4. Plot pixel in 160x144 display view
-	
 	int y = currentScanline;
-	
-	// Iterate from left to right of display screen (x = 0 -> 160)
-	for (int x = 0; x < 160; x++)
-	{
-		//1. Calculate where the pixel resides in the overall 256x256 background map (including the offset of scroll)
-		int map_x = (int)scrollX + x;
-		int map_y = (int)scrollY + y;
-
-		// wrap around if the map_x is > than the 256x256 background map
-		map_x = (map_x >= 256) ? (map_x - 256) : map_x;
-		map_y = (map_y >= 256) ? (map_y - 256) : map_y;
 
-		//2. Get the tile ID where that pixel is located
-		int tile_col = map_x / 8;
-		int tile_row = map_y / 8;
-		int tile_map_id = tile_col + (tile_row * 32);
-
-		Address backAddr = backgroundLocation + tile_map_id;
-		Byte tile_id = readMemory(backAddr);
-
-		// 3. Get the pixel color based on that coordinate relative to the 8x8 tile grid
-		// 4. Plot pixel in 160x144 display view
-		int tile_x_pixel = map_x % 8;
-		int tile_y_pixel = map_y % 8;
-
-		//Invert the x pixels b/c they are stored backwards
-		tile_x_pixel = abs(tile_x_pixel - 7);
-
-		offset = (unsig) ? (tile_id * 16 + tileLocation) : (Address) (((Byte_Signed)tile_id) * 16 + tileLocation);
-		
-		//Palette Bytes are stored as two bytes per pixel
-		Byte high = readMemory(offset + (tile_y_pixel * 2) + 1);
-		Byte low = readMemory(offset + (tile_y_pixel * 2));
-
-		//now have the colour id get the actual colour from palette 0xFF47
-		Byte palette = readMemory(0xFF47);
-		uint32_t colourID = getColour(palette, high, low, tile_x_pixel, false);
-		
-		bgData[y * 160 + x] = colourID;
+	//the row of the 256x256 background the scanline shows, wrapping around at the bottom (see TileMaps)
+	const Byte * row = tileMaps.row(memory, testBit(lcdControl, 3), testBit(lcdControl, 4), (scrollY + y) & 0xFF);
 
-	}
+	// Iterate from left to right of display screen (x = 0 -> 160), wrapping around if it goes past the right
+	for (int x = 0; x < 160; x++)
+		bgData[y * 160 + x] = backgroundColours[row[(scrollX + x) & 0xFF]];
 }
 
-void Emulator::renderWindow()
+void Emulator::renderWindow(Byte line)
 {
-	Address tileLocation = 0, windowLocation = 0;
-	Address offset;
 	Byte lcdControl = readMemory(0xFF40);
-	Byte currentScanline = readMemory(0xFF44);
-	bool unsig = true;
-
-	//Get current window tile map
-	windowLocation = testBit(lcdControl, 6) ? 0x9C00 : 0x9800;
-
-	tileLocation = testBit(lcdControl, 4) ? 0x8000 : 0x9000;
-
-	//check tile data
-	if (!testBit(lcdControl, 4))
-		unsig = false; //using unsigned values
+	Byte currentScanline = line;
 
 	/*WindowY (0xFF4A): The Y Position of the VIEWING AREA to start drawing the window from
 	WindowX (0xFF4B): The X Positions -7 of the VIEWING AREA to start drawing the window from */
@@ -419,65 +385,27 @@ void Emulator::renderWindow()
 	if (windowX < 7)
 		windowX = 7;
 
-	// For each pixel in the 160x1 scanline:
-	// 1. Calculate where the pixel resides in the overall 256x256 background map
-	// 2. Get the tile ID where that pixel is located
-	// 3. Get the pixel color based on that coordinate relative to the 8x8 tile grid
-	// 4. Plot pixel in 160x144 display view
-
 	int y = currentScanline;
 
-	// Iterate from left to right of display screen (x = 0 -> 160)
-	for (int x = 0; x < 160; x++)
+	if (currentScanline < windowY) //set x,y to black and transparent?
 	{
-		// 1. Calculate where the pixel resides in the overall 256x256 background map
-		// WINDOW IS RELATIVE TO THE SCREEN
-		// Shift X & Y pixels based on window register value
-		int display_x = x +  windowX - 7;
-		int display_y = y;
-
-		//2. Get the tile ID where that pixel is located
-		int tile_col = x / 8;
-		int tile_row = (y - windowY) / 8; //?
-		int tile_map_id = tile_col + (tile_row * 32);
-
-		Address windowAddr = windowLocation + tile_map_id;
-		Byte tile_id = readMemory(windowAddr);
-
-		// 3. Get the pixel color based on that coordinate relative to the 8x8 tile grid
-		// 4. Plot pixel in 160x144 display view
-		int tile_x_pixel = x % 8;
-		int tile_y_pixel = y % 8;
-
+		memset(&windowData[currentScanline * 160], 0, 160 * sizeof(uint32_t));
+		return;
+	}
 
-		//Invert the x pixels b/c they are stored backwards
-		tile_x_pixel = abs(tile_x_pixel - 7);
-		
-		if (currentScanline < windowY) //set x,y to black and transparent?
-		{
-			windowData[currentScanline * 160 + x] = 0x00000000;
-			
-		}
+	if (y >= 144)
+		return;
 
-		else
-		{
-			if (display_x >= 160 || display_x < 0) return;
-			if (display_y >= 144 || display_y < 0) return;
-			
-			offset = (unsig) ? (tile_id * 16 + tileLocation) : (Address)(((Byte_Signed)tile_id) * 16 + tileLocation);
-
-			//Palette Bytes are stored as two bytes per pixel
-			Byte high = readMemory(offset + (tile_y_pixel * 2) + 1);
-			Byte low = readMemory(offset + (tile_y_pixel * 2));
-
-			//now have the colour id get the actual colour from palette 0xFF47
-			Byte palette = readMemory(0xFF47);
-			uint32_t colourID = getColour(palette, low, high, tile_x_pixel, false);
-			
-			windowData[display_x + display_y*160] = colourID;
-		}
+	/*The window is drawn from the top left of its tile map, the tile row comes from how far down the window the 
+	scanline is but the row inside the tiles from the scanline itself*/
+	int map_y = ((y - windowY) / 8) * 8 + (y % 8);
+	const Byte * row = tileMaps.row(memory, testBit(lcdControl, 6), testBit(lcdControl, 4), map_y);
 
-	}
+	// Shift X pixels based on window register value, anything past the right of the screen is cut off
+	int display_x = windowX - 7;
+	int count = 160 - display_x;
+	for (int x = 0; x < count; x++)
+		windowData[display_x + x + y * 160] = windowColours[row[x]];
 }
 
 /*The sprite data is located in memory address 0x8000-0x8FFF which means the sprite identifiers 
@@ -508,22 +436,22 @@ void Emulator::renderSprites()
 	Address 
 		spriteDataLocation = 0xFE00,
 		offset;
-	Byte palette0 = memory[0xFF48];
-	Byte palette1 = memory[0xFF49];
-
 	bool use8x16 = testBit(memory[0xFF40],2) ? true : false;
 
-	//40 potential sprites to render maximum so start at 39 to have right priority [39->0 = 40]
-	for (int spriteID = 39; spriteID >= 0; spriteID--)
+	if (oamDirty)
+		findVisibleSprites();
+
+	//oam is read directly, the cpu might not be able to get at it right now (see doDMATransfer)
+	for (int i = 0; i < visibleSpriteCount; i++)
 	{
-		offset = spriteDataLocation + (spriteID * 4); //160 bytes of sprite / 40 = 4 bytes per sprite
-		int yPos = ((int)readMemory(offset)) - 16;
-		int xPos = ((int)readMemory(offset + 1)) - 8; 
+		offset = spriteDataLocation + (visibleSprites[i] * 4); //160 bytes of sprite / 40 = 4 bytes per sprite
+		int yPos = ((int)memory[offset]) - 16;
+		int xPos = ((int)memory[offset + 1]) - 8; 
 
-		Byte tileNumber = readMemory(offset + 2);
-		Byte attributes = readMemory(offset + 3);
+		Byte tileNumber = memory[offset + 2];
+		Byte attributes = memory[offset + 3];
 
-		Byte spritePalette = (testBit(attributes, 4)) ? palette1 : palette0; //1 = palette 1 & so forth
+		const uint32_t * spritePalette = spriteColours[testBit(attributes, 4) ? 1 : 0]; //1 = palette 1 & so forth
 
 		// If in 8x16 mode, the tile pattern for top is tileNumber & 0xFE
 		// Lower 8x8 tile is tileNumber | 0x1
@@ -540,7 +468,24 @@ void Emulator::renderSprites()
 	}	
 }
 
-void Emulator::renderSpriteTiles(Byte palette, int startX, int startY, Byte tileID, Byte flags)
+/*Sprites parked off the screen (Y = 0 is the usual way of hiding one) still got every one of their pixels checked, 
+now only the ones that could have a pixel on the screen at either sprite size get drawn. 40 potential sprites to 
+render maximum so start at 39 to have right priority [39->0 = 40]*/
+void Emulator::findVisibleSprites()
+{
+	visibleSpriteCount = 0;
+	for (int spriteID = 39; spriteID >= 0; spriteID--)
+	{
+		Byte y = memory[0xFE00 + spriteID * 4];
+		Byte x = memory[0xFE00 + spriteID * 4 + 1];
+
+		if (y > 0 && y < 144 + 16 && x > 0 && x < 160 + 8)
+			visibleSprites[visibleSpriteCount++] = spriteID;
+	}
+	oamDirty = false;
+}
+
+void Emulator::renderSpriteTiles(const uint32_t * colours, int startX, int startY, Byte tileID, Byte flags)
 {
 	Address spriteDataLocation = 0x8000;
 
@@ -557,8 +502,8 @@ void Emulator::renderSpriteTiles(Byte palette, int startX, int startY, Byte tile
 		int offset = (tileID * 16) + spriteDataLocation;
 
 		Byte
-			high = readMemory(offset + (y * 2) + 1),
-			low = readMemory(offset + (y * 2));
+			high = memory[offset + (y * 2) + 1],
+			low = memory[offset + (y * 2)];
 
 		for (int x = 0; x < 8; x++)
 		{
@@ -570,7 +515,7 @@ void Emulator::renderSpriteTiles(Byte palette, int startX, int startY, Byte tile
 			if (pixel_y < 0 || pixel_y >= height)
 				continue;
 
-			uint32_t color = getColour(palette, low, high, x, true);
+			uint32_t color = colours[(((high >> x) & 1) << 1) | ((low >> x) & 1)];
 
 			uint32_t bg_color = bgData[pixel_x + 160 * pixel_y]; //get the background colour
 
@@ -586,7 +531,23 @@ void Emulator::renderSpriteTiles(Byte palette, int startX, int startY, Byte tile
 
 }
 
-int Emulator::getColour(Byte palette, Byte top, Byte bottom, int bit, bool isSprite)
+/*The palettes only change when the game writes them (see writeMemory) so the colour each colour number comes out as 
+gets worked out then instead of for every pixel. Scanlines that haven't been drawn yet get drawn before the write 
+so every line is still drawn with the palettes it was shown with.*/
+void Emulator::updatePalettes()
+{
+	for (int colour = 0; colour < 4; colour++)
+	{
+		//the background reads the colour number with the two tile bytes the other way round to the window & sprites
+		int swapped = ((colour & 1) << 1) | (colour >> 1);
+		backgroundColours[colour] = getColour(memory[0xFF47], swapped, false);
+		windowColours[colour] = getColour(memory[0xFF47], colour, false);
+		spriteColours[0][colour] = getColour(memory[0xFF48], colour, true);
+		spriteColours[1][colour] = getColour(memory[0xFF49], colour, true);
+	}
+}
+
+uint32_t Emulator::getColour(Byte palette, int colorCode, bool isSprite)
 {
 	
 	// Figure out what colors to apply to each color code based on the palette data
@@ -595,11 +556,6 @@ int Emulator::getColour(Byte palette, Byte top, Byte bottom, int bit, bool isSpr
 	Byte colorShade1 = (palette & 0x0C) >> 2; //extract bits 3 & 2
 	Byte colorShade0 = palette & 0x03;  //extract bits 1 & 0
 	
-	// Get color code from the two defining bytes
-	Byte first = (Byte)testBit(top, bit);
-	Byte second = (Byte)testBit(bottom, bit);
-	Byte colorCode = (second << 1) | first;
-	
 	switch (colorCode)
 	{
 		case 0: return (isSprite)? 0xFFFFFFFF : colorShades[colorShade0]; 
@@ -610,11 +566,3 @@ int Emulator::getColour(Byte palette, Byte top, Byte bottom, int bit, bool isSpr
 	}
 
 }
-
-void Emulator::destroySDL()
-{
-	SDL_FreeSurface(bgSurf);
-	SDL_FreeSurface(spriteSurf);
-	SDL_FreeSurface(windowSurf);
-	SDL_FreeSurface(screenSurface);
-}
@@ -1,18 +1,151 @@
 #include <SDL.h>
 #include <iostream>
 #include <fstream> //for file
+#include <string.h>
 
 
 #include "types.h"
 #include "Emulator.h"
+#include "testrunner.h"
+#include "FrameTrace.h"
 
 using namespace std;
 
-Byte cartridgeMemory[0x200000];
-
 int main(int argc, char *args[])
 {
-	
+	/*GrahamBoy -blocks/-jit ... --> runs any of the modes below on the block cache/jit instead of the interpreter. 
+	Adding -tcache saves the blocks next to the rom & loads them on the next run so it doesn't have to warm up again. 
+	-aotmodule <file> runs on the jit with the blocks from a module built from the output of -aot (see Aot.h).
+	-fifo steps the lcd a dot at a time through a pixel fifo instead of drawing whole scanlines (see Ppu.h) & -mcycle 
+	hands the timers & lcd every machine cycle of an instruction as its memory accesses happen (see CpuTiming.h).*/
+	CpuEngine engine = CPU_INTERPRETER;
+	PpuTier ppu = PPU_SCANLINE;
+	CpuTiming timing = CPU_TIMING_INSTRUCTION;
+	bool translationCache = false;
+	const char * aotModule = NULL;
+	while (argc > 1 && (strcmp(args[1], "-blocks") == 0 || strcmp(args[1], "-jit") == 0 || strcmp(args[1], "-tcache") == 0 ||
+		strcmp(args[1], "-fifo") == 0 || strcmp(args[1], "-mcycle") == 0 ||
+		(argc > 2 && strcmp(args[1], "-aotmodule") == 0)))
+	{
+		if (strcmp(args[1], "-tcache") == 0)
+			translationCache = true;
+		else if (strcmp(args[1], "-fifo") == 0)
+			ppu = PPU_PIXEL_FIFO;
+		else if (strcmp(args[1], "-mcycle") == 0)
+			timing = CPU_TIMING_MCYCLE;
+		else if (strcmp(args[1], "-aotmodule") == 0)
+		{
+			aotModule = args[2];
+			args++;
+			argc--;
+		}
+		else
+			engine = (strcmp(args[1], "-jit") == 0) ? CPU_JIT : CPU_BLOCK_CACHE;
+		args++;
+		argc--;
+	}
+
+	//GrahamBoy -test [roms...] --> runs the test roms headless & reports pass/fail
+	if (argc > 1 && strcmp(args[1], "-test") == 0)
+		return runTestRoms(argc - 2, args + 2, engine, ppu, timing);
+
+	//GrahamBoy -profile <rom> [frames] --> prints where the game spends its cycles, runs headless if given a # of frames
+	if (argc > 2 && strcmp(args[1], "-profile") == 0)
+	{
+		int frames = (argc > 3) ? atoi(args[3]) : 0;
+		Emulator * profiled = new Emulator(frames > 0);
+		GuestProfiler * profiler = new GuestProfiler();
+
+		int result = -1;
+		profiled->setCpuEngine(engine);
+		profiled->setPpu(ppu);
+		profiled->setCpuTiming(timing);
+		profiled->setTranslationCache(translationCache);
+		profiled->setAotModule(aotModule);
+		if (profiled->loadRom(args[2]))
+		{
+			profiled->runProfiled(*profiler, frames);
+			profiler->report(*profiled, stdout, 100);
+			result = 0;
+		}
+
+		delete profiler;
+		delete profiled;
+		return result;
+	}
+
+	/*GrahamBoy -trace <rom> <file> [millions] --> keeps the last N million instructions (default 1) in memory 
+	& writes them to file on exit or if the emulator crashes. -tracestream writes every instruction to file as 
+	it runs instead. Either way GrahamBoy -decode <file> turns the trace into text.*/
+	if (argc > 3 && (strcmp(args[1], "-trace") == 0 || strcmp(args[1], "-tracestream") == 0))
+	{
+		bool stream = strcmp(args[1], "-tracestream") == 0;
+		int millions = (argc > 4) ? atoi(args[4]) : 1;
+		Emulator * traced = new Emulator();
+		InstructionTracer * tracer = new InstructionTracer((size_t)(millions > 0 ? millions : 1) * 1000000);
+
+		int result = -1;
+		traced->setCpuEngine(engine);
+		traced->setPpu(ppu);
+		traced->setCpuTiming(timing);
+		traced->setTranslationCache(translationCache);
+		traced->setAotModule(aotModule);
+		if (traced->loadRom(args[2]))
+		{
+			if (stream)
+				tracer->startStreaming(args[3]);
+			else
+				tracer->dumpOnCrash(args[3]);
+
+			traced->runTraced(*tracer, 0);
+
+			if (stream)
+				tracer->stopStreaming();
+			else
+				tracer->dump(args[3]);
+			result = 0;
+		}
+
+		delete tracer;
+		delete traced;
+		return result;
+	}
+
+	//GrahamBoy -aot <rom> <out.cpp> --> writes all the rom code it can find out as C++ to build into a module (see Aot.h)
+	if (argc > 3 && strcmp(args[1], "-aot") == 0)
+	{
+		Emulator * compiler = new Emulator(true);
+		int result = (compiler->loadRom(args[2]) && compiler->writeAotModule(args[2], args[3])) ? 0 : -1;
+		delete compiler;
+		return result;
+	}
+
+	if (argc > 2 && strcmp(args[1], "-decode") == 0)
+		return decodeTrace(args[2], stdout);
+
+	/*GrahamBoy -frametrace <rom> <file.json> --> times each phase of every frame & writes them out on exit 
+	in the chrome trace event format (open in chrome://tracing or ui.perfetto.dev)*/
+	if (argc > 3 && strcmp(args[1], "-frametrace") == 0)
+	{
+		FrameTrace::enable(1 << 20);
+		Emulator * timed = new Emulator();
+
+		int result = -1;
+		timed->setCpuEngine(engine);
+		timed->setPpu(ppu);
+		timed->setCpuTiming(timing);
+		timed->setTranslationCache(translationCache);
+		timed->setAotModule(aotModule);
+		if (timed->loadRom(args[2]))
+		{
+			timed->run();
+			result = FrameTrace::exportJson(args[3]) ? 0 : -1;
+		}
+
+		delete timed;
+		return result;
+	}
+
 	Emulator gameBoy;
 	
 	//char * juba = "jfoaf"; --> doesn't work, gives an error!
@@ -23,6 +156,11 @@ int main(int argc, char *args[])
 	//char game[] =  "C:/Users/lemar/source/repos/GrahamBoy/Tetris (World) (Rev A).gb";
 	//char game[] =  "C:/Users/lemar/source/repos/GrahamBoy/Legend of Zelda, The - Link's Awakening (Canada).gb";
 	char game[] = "C:/Users/lemar/source/repos/Test/x64/Release/kirby.gb";
+	gameBoy.setCpuEngine(engine);
+	gameBoy.setPpu(ppu);
+	gameBoy.setCpuTiming(timing);
+	gameBoy.setTranslationCache(translationCache);
+	gameBoy.setAotModule(aotModule);
 	gameBoy.loadRom(game);
 	
 	gameBoy.run();
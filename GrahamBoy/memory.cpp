@@ -1,4 +1,5 @@
 #include "Emulator.h"
+#include "BlockCache.h"
 
 /*Internal memory only has room for 0x8000 (0x0000 - 0x7FFF) of the game memory. 
 However most games are bigger in size than 0x8000 which is why memory banking is needed. 
@@ -14,6 +15,26 @@ to ECHO memory needs to be reflected in work RAM. Also when reading from one of
 that it gets read from the correct bank. */
 void Emulator::writeMemory(Word address, Byte data)
 {
+	//nothing but the io registers & high ram can be reached during an oam dma
+	if (address < 0xFF00 && totalCycles < dmaEndsAt)
+		return;
+
+	if (address >= 0x8000)
+	{
+		//scanlines that finished before this write have to be drawn with what was there before it
+		if (undrawnLines > 0 && ((address < 0xA000) || (address >= 0xFE00 && address < 0xFEA0) ||
+			(address >= 0xFF40 && address <= 0xFF4B && address != 0xFF41)))
+			drawPendingLines();
+
+		if (address < 0xA000)
+			tileMaps.written(address);
+		else if (address >= 0xFE00 && address < 0xFEA0)
+			oamDirty = true;
+
+		if (address == 0xFF0F || address == 0xFF40 || address == 0xFF41 || address == 0xFF44 || address == 0xFF45)
+			catchUpGraphics();
+	}
+
 	if (address < 0x8000)
 		handleBanking(address, data);
 
@@ -35,14 +56,14 @@ void Emulator::writeMemory(Word address, Byte data)
 		}
 	}
 
-	// we're writing to internal RAM, so this is the echo
-	else if (address >= 0xC000 && address <= 0xDFFF)
-		memory[address] = data;
-
-	else if (address >= 0xE000 && address <= 0xFDFF)
+	/*we're writing to internal RAM or its echo. The echo has no memory of its own, it's the same bytes as 
+	0xC000-0xDDFF (see readMemory & mapReadPages) so both always agree*/
+	else if (address >= 0xC000 && address <= 0xFDFF)
 	{
-		memory[address] = data;
-		writeMemory(address - 0x2000, data); //do the echoing
+		Word ramAddress = (address >= 0xE000) ? address - 0x2000 : address;
+		memory[ramAddress] = data;
+		if (blockCache)
+			blockCache->ramWritten(ramAddress);
 	}
 
 	else if (address >= 0xFEA0 && address <= 0xFEFF)
@@ -55,6 +76,10 @@ void Emulator::writeMemory(Word address, Byte data)
 	counter so it counts at the new frequency*/
 	else if (address == TMC)
 	{
+		//the cycles before this have to be counted with the old setting, the next event gets worked out again
+		syncTimers();
+		nextTimerEvent = 0;
+
 		Byte currentFreq = getClockFreq();
 		memory[address] = data; //update the frequency
 		Byte newFreq = getClockFreq();
@@ -83,6 +108,13 @@ void Emulator::writeMemory(Word address, Byte data)
 		doDMATransfer(data);
 	}
 
+	//the palettes, the colours they pick get worked out here instead of for every pixel
+	else if (address >= 0xFF47 && address <= 0xFF49)
+	{
+		memory[address] = data;
+		updatePalettes();
+	}
+
 	//restricted area
 	else if ((address >= 0xFF4C) && (address <= 0xFF7F))
 		return;
@@ -90,8 +122,27 @@ void Emulator::writeMemory(Word address, Byte data)
 	else if (address == 0xFF00) //Joypad
 		memory[address] = data & 0x30;
 
+	//serial transfer control, 0x81 = start a transfer using the internal clock --> grab the byte sitting in SB
+	else if (address == 0xFF02)
+	{
+		memory[address] = data;
+		if (data == 0x81)
+			serialOutput += (char)memory[0xFF01];
+	}
+
+	//interrupt request & enable registers
+	else if (address == 0xFF0F || address == 0xFFFF)
+	{
+		memory[address] = data;
+		updateInterruptPending();
+	}
+
 	else
+	{
 		memory[address] = data;
+		if (blockCache && address >= 0xFF80) //high ram
+			blockCache->ramWritten(address);
+	}
 
 	return;
 }
@@ -99,7 +150,10 @@ void Emulator::writeMemory(Word address, Byte data)
 // read memory should never modify member variables hence const
 Byte Emulator::readMemory(Word address) const
 {
-	
+	//the bus is busy with an oam dma, only the io registers & high ram can be read
+	if (address < 0xFF00 && totalCycles < dmaEndsAt)
+		return 0xFF;
+
 	//reading from the cartridge rom bank
 	if (address >= 0x4000 && address <= 0x7FFF)
 	{
@@ -116,6 +170,10 @@ Byte Emulator::readMemory(Word address) const
 		return ramBank[newAddress + (currentRamBank * 0x2000)]; 
 	}
 
+	//echo ram reads the work ram it mirrors
+	else if (address >= 0xE000 && address <= 0xFDFF)
+		return memory[address - 0x2000];
+
 	else if (address == 0xFF00)
 		return getJoypadState();
 
@@ -163,9 +221,41 @@ void Emulator::handleBanking(Word address, Byte data)
 			changeRomRamMode(data);
 	}
 
+	mapReadPages();
 	return;
 }
 
+Byte Emulator::peekCode(Address address) const
+{
+	const Byte * page = readPages[address >> 12];
+	return page ? page[address & 0xFFF] : readMemory(address);
+}
+
+void Emulator::mapReadPages()
+{
+	for (int page = 0x0; page < 0x4; page++)
+		readPages[page] = &memory[page * 0x1000]; //rom bank 0 gets copied into memory by loadRom
+
+	for (int page = 0x4; page < 0x8; page++)
+		readPages[page] = &cartridgeMemory[(currentRomBank * 0x4000) + ((page - 0x4) * 0x1000)];
+
+	for (int page = 0x8; page < 0xA; page++)
+		readPages[page] = &memory[page * 0x1000];
+
+	for (int page = 0xA; page < 0xC; page++)
+		readPages[page] = &ramBank[(currentRamBank * 0x2000) + ((page - 0xA) * 0x1000)];
+
+	for (int page = 0xC; page < 0xE; page++)
+		readPages[page] = &memory[page * 0x1000];
+
+	readPages[0xE] = &memory[0xC000]; //echo ram, the rest of it is in the last page
+
+	readPages[0xF] = NULL;
+
+	if (blockCache)
+		blockCache->leaveBlock();
+}
+
 /*In order to write to RAM banks the game must specifically request that ram bank writing is enabled. 
 It does this by attempting to write to internal ROM address between 0 and 0x2000. 
 For MBC1 if the lower nibble of the data the game is writing to memory is 0xA then ram bank writing is 
@@ -0,0 +1,128 @@
+#include "testrunner.h"
+#include "Emulator.h"
+#include "types.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+//a rom that hasn't printed a result after this many frames (~60 seconds of gameboy time) is hung
+const int TEST_TIMEOUT_FRAMES = 60 * 60;
+
+static const char * const s_default_roms[] = {
+	"../gb-test-roms-master/cpu_instrs/individual/01-special.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/02-interrupts.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/03-op sp,hl.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/04-op r,imm.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/05-op rp.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/06-ld r,r.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/07-jr,jp,call,ret,rst.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/08-misc instrs.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/09-op r,r.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/10-bit ops.gb",
+	"../gb-test-roms-master/cpu_instrs/individual/11-op a,(hl).gb",
+};
+
+struct TestJob
+{
+	const char * rom;
+	CpuEngine engine;
+	PpuTier ppu;
+	CpuTiming timing;
+	int status;
+	std::string output;
+	double seconds;
+};
+
+static void runJob(TestJob & job)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	//each emulator is ~3MB so keep them off the (small) worker stacks
+	Emulator * gameBoy = new Emulator(true);
+	gameBoy->setCpuEngine(job.engine);
+	gameBoy->setPpu(job.ppu);
+	gameBoy->setCpuTiming(job.timing);
+
+	if (gameBoy->loadRom(job.rom))
+	{
+		job.status = gameBoy->runTest(TEST_TIMEOUT_FRAMES);
+		job.output = gameBoy->getSerialOutput();
+	}
+	else
+		job.status = TEST_NO_ROM;
+
+	delete gameBoy;
+
+	job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int runTestRoms(int count, char * roms[], CpuEngine engine, PpuTier ppu, CpuTiming timing)
+{
+	std::vector<TestJob> jobs;
+
+	if (count > 0)
+	{
+		for (int i = 0; i < count; i++)
+			jobs.push_back({ roms[i], engine, ppu, timing, TEST_TIMEOUT, "", 0.0 });
+	}
+	else
+	{
+		for (const char * rom : s_default_roms)
+			jobs.push_back({ rom, engine, ppu, timing, TEST_TIMEOUT, "", 0.0 });
+	}
+
+	//every rom gets its own emulator so they can all run at once, workers just pull the next unclaimed rom
+	unsigned int numWorkers = std::thread::hardware_concurrency();
+	if (numWorkers == 0)
+		numWorkers = 1;
+	if (numWorkers > jobs.size())
+		numWorkers = (unsigned int)jobs.size();
+
+	std::atomic<size_t> nextJob(0);
+	std::vector<std::thread> workers;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(std::thread([&jobs, &nextJob]()
+		{
+			for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+				runJob(jobs[job]);
+		}));
+	}
+
+	for (std::thread & worker : workers)
+		worker.join();
+
+	double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int failures = 0;
+	for (const TestJob & job : jobs)
+	{
+		const char * result = "";
+		switch (job.status)
+		{
+			case TEST_PASSED: result = "PASSED"; break;
+			case TEST_FAILED: result = "FAILED"; break;
+			case TEST_TIMEOUT: result = "TIMEOUT"; break;
+			case TEST_NO_ROM: result = "NO ROM"; break;
+		}
+
+		if (job.status != TEST_PASSED)
+			failures++;
+
+		printf("%-8s %-60s %6.2fs\n", result, job.rom, job.seconds);
+
+		//show what the rom had to say about it
+		if (job.status == TEST_FAILED || job.status == TEST_TIMEOUT)
+			printf("%s\n", job.output.c_str());
+	}
+
+	printf("%d/%d passed in %.2fs (%u threads)\n", (int)jobs.size() - failures, (int)jobs.size(), total, numWorkers);
+
+	return failures;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "Emulator.h"
+
+/*Runs every rom given in its own headless emulator, one worker thread per core. With no roms given it 
+runs blargg's individual cpu_instrs roms that ship with the repo. Returns the number of roms that didn't pass.*/
+int runTestRoms(int count, char * roms[], CpuEngine engine = CPU_INTERPRETER, PpuTier ppu = PPU_SCANLINE, CpuTiming timing = CPU_TIMING_INSTRUCTION);
@@ -7,8 +7,6 @@ typedef uint8_t Byte, Opcode;
 typedef int8_t Byte_Signed;
 typedef int16_t Word_Signed;
 
-extern Byte cartridgeMemory[0x200000];
-
 
 union Register
 {